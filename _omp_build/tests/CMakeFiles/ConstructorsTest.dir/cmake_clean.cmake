@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ConstructorsTest.dir/ConstructorsTest.cpp.o"
+  "CMakeFiles/ConstructorsTest.dir/ConstructorsTest.cpp.o.d"
+  "ConstructorsTest"
+  "ConstructorsTest.cpp"
+  "ConstructorsTest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ConstructorsTest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/DocGettingStartedTest.dir/DocGettingStartedTest.cpp.o"
+  "CMakeFiles/DocGettingStartedTest.dir/DocGettingStartedTest.cpp.o.d"
+  "DocGettingStartedTest"
+  "DocGettingStartedTest.cpp"
+  "DocGettingStartedTest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/DocGettingStartedTest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
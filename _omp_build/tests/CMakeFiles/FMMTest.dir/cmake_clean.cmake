@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/FMMTest.dir/FMMTest.cpp.o"
+  "CMakeFiles/FMMTest.dir/FMMTest.cpp.o.d"
+  "FMMTest"
+  "FMMTest.cpp"
+  "FMMTest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/FMMTest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
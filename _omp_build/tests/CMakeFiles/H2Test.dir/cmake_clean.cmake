@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/H2Test.dir/H2Test.cpp.o"
+  "CMakeFiles/H2Test.dir/H2Test.cpp.o.d"
+  "H2Test"
+  "H2Test.cpp"
+  "H2Test.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/H2Test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/NeighboursTest.dir/NeighboursTest.cpp.o"
+  "CMakeFiles/NeighboursTest.dir/NeighboursTest.cpp.o.d"
+  "NeighboursTest"
+  "NeighboursTest.cpp"
+  "NeighboursTest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/NeighboursTest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,12 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/VariablesTest.dir/VariablesTest.cpp.o"
+  "CMakeFiles/VariablesTest.dir/VariablesTest.cpp.o.d"
+  "VariablesTest"
+  "VariablesTest.cpp"
+  "VariablesTest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/VariablesTest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,97 @@
+/* Generated file, do not edit */
+
+#ifndef CXXTEST_RUNNING
+#define CXXTEST_RUNNING
+#endif
+
+#define _CXXTEST_HAVE_STD
+#include <cxxtest/TestListener.h>
+#include <cxxtest/TestTracker.h>
+#include <cxxtest/TestRunner.h>
+#include <cxxtest/RealDescriptions.h>
+#include <cxxtest/TestMain.h>
+#include <cxxtest/ErrorPrinter.h>
+
+int main( int argc, char *argv[] ) {
+ int status;
+    CxxTest::ErrorPrinter tmp;
+    CxxTest::RealWorldDescription::_worldName = "cxxtest";
+    status = CxxTest::Main< CxxTest::ErrorPrinter >( tmp, argc, argv );
+    return status;
+}
+bool suite_NeighboursTest_init = false;
+#include "../../tests/neighbours.h"
+
+static NeighboursTest suite_NeighboursTest;
+
+static CxxTest::List Tests_NeighboursTest = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_NeighboursTest( "/root/repo/tests/neighbours.h", 47, "NeighboursTest", suite_NeighboursTest, Tests_NeighboursTest );
+
+static class TestDescription_suite_NeighboursTest_test_documentation : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_documentation() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 53, "test_documentation" ) {}
+ void runTest() { suite_NeighboursTest.test_documentation(); }
+} testDescription_suite_NeighboursTest_test_documentation;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_CellList : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_CellList() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1479, "test_std_vector_CellList" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_CellList(); }
+} testDescription_suite_NeighboursTest_test_std_vector_CellList;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_CellListOrdered : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_CellListOrdered() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1489, "test_std_vector_CellListOrdered" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_CellListOrdered(); }
+} testDescription_suite_NeighboursTest_test_std_vector_CellListOrdered;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_CellList_fast_bucketsearch : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_CellList_fast_bucketsearch() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1501, "test_std_vector_CellList_fast_bucketsearch" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_CellList_fast_bucketsearch(); }
+} testDescription_suite_NeighboursTest_test_std_vector_CellList_fast_bucketsearch;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_CellListOrdered_fast_bucketsearch : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_CellListOrdered_fast_bucketsearch() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1508, "test_std_vector_CellListOrdered_fast_bucketsearch" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_CellListOrdered_fast_bucketsearch(); }
+} testDescription_suite_NeighboursTest_test_std_vector_CellListOrdered_fast_bucketsearch;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_Kdtree : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_Kdtree() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1515, "test_std_vector_Kdtree" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_Kdtree(); }
+} testDescription_suite_NeighboursTest_test_std_vector_Kdtree;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_KdtreeNanoflann : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_KdtreeNanoflann() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1523, "test_std_vector_KdtreeNanoflann" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_KdtreeNanoflann(); }
+} testDescription_suite_NeighboursTest_test_std_vector_KdtreeNanoflann;
+
+static class TestDescription_suite_NeighboursTest_test_std_vector_HyperOctree : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_std_vector_HyperOctree() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1531, "test_std_vector_HyperOctree" ) {}
+ void runTest() { suite_NeighboursTest.test_std_vector_HyperOctree(); }
+} testDescription_suite_NeighboursTest_test_std_vector_HyperOctree;
+
+static class TestDescription_suite_NeighboursTest_test_thrust_vector_CellListOrdered : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_thrust_vector_CellListOrdered() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1545, "test_thrust_vector_CellListOrdered" ) {}
+ void runTest() { suite_NeighboursTest.test_thrust_vector_CellListOrdered(); }
+} testDescription_suite_NeighboursTest_test_thrust_vector_CellListOrdered;
+
+static class TestDescription_suite_NeighboursTest_test_thrust_vector_HyperOctree : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_thrust_vector_HyperOctree() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1553, "test_thrust_vector_HyperOctree" ) {}
+ void runTest() { suite_NeighboursTest.test_thrust_vector_HyperOctree(); }
+} testDescription_suite_NeighboursTest_test_thrust_vector_HyperOctree;
+
+static class TestDescription_suite_NeighboursTest_test_thrust_vector_Kdtree : public CxxTest::RealTestDescription {
+public:
+ TestDescription_suite_NeighboursTest_test_thrust_vector_Kdtree() : CxxTest::RealTestDescription( Tests_NeighboursTest, suiteDescription_NeighboursTest, 1560, "test_thrust_vector_Kdtree" ) {}
+ void runTest() { suite_NeighboursTest.test_thrust_vector_Kdtree(); }
+} testDescription_suite_NeighboursTest_test_thrust_vector_Kdtree;
+
+#include <cxxtest/Root.cpp>
+const char* CxxTest::RealWorldDescription::_worldName = "cxxtest";
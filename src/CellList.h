@@ -986,6 +986,11 @@ struct CellListQuery : public NeighbourQueryBase<Traits> {
   ///
   size_t *m_id_map_value;
 
+  ///
+  /// @brief the size of the dense find-by-id map, or zero if it is sorted
+  ///
+  size_t m_id_map_dense_size;
+
   ///
   /// @brief constructor checks that we are not using std::vector and cuda
   /// at the same time
@@ -1006,14 +1011,10 @@ struct CellListQuery : public NeighbourQueryBase<Traits> {
   ABORIA_HOST_DEVICE_IGNORE_WARN
   CUDA_HOST_DEVICE
   raw_pointer find(const size_t id) const {
-    const size_t n = number_of_particles();
-    size_t *last = m_id_map_key + n;
-    size_t *first = detail::lower_bound(m_id_map_key, last, id);
-    if ((first != last) && !(id < *first)) {
-      return m_particles_begin + m_id_map_value[first - m_id_map_key];
-    } else {
-      return m_particles_begin + n;
-    }
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
   }
 
   /*
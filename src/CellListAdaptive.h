@@ -0,0 +1,1018 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef CELL_LIST_ADAPTIVE_H_
+#define CELL_LIST_ADAPTIVE_H_
+
+#include "CudaInclude.h"
+#include "Get.h"
+#include "NeighbourSearchBase.h"
+#include "SpatialUtil.h"
+#include "Traits.h"
+#include "Vector.h"
+#include "detail/Algorithms.h"
+
+#include "Log.h"
+#include <iostream>
+
+namespace Aboria {
+
+template <typename Traits> struct CellListAdaptiveQuery;
+
+/// @brief A two-level cell list spatial data structure that is paired with a
+/// CellListAdaptiveQuery query type
+///
+/// This class implements neighbourhood searching using a regular grid of
+/// constant size "buckets", exactly like CellListOrdered. In addition, any
+/// bucket that holds more than #subdivide_ratio times the requested number of
+/// particles per bucket is subdivided into a finer regular sub-grid, sized so
+/// that the sub-buckets hold the requested number of particles on average.
+/// This keeps the neighbour searches efficient for strongly clustered particle
+/// distributions, where a uniform cell list would end up with a few buckets
+/// holding most of the particles.
+///
+/// The top-level buckets are stored in the same flat arrays as
+/// CellListOrdered, so algorithms that loop over pairs of buckets (e.g.
+/// get_neighbouring_buckets() or the bucket_pair_iterator) work unchanged on
+/// the top-level grid. Neighbour searches (e.g. euclidean_search()) descend
+/// into the sub-grids. The sub-grids are built on the host.
+///
+/// Buckets are only subdivided once: the sub-buckets are not themselves
+/// subdivided, however many particles they hold. A cluster that is much
+/// smaller than a sub-bucket therefore still ends up in a single sub-bucket.
+/// The searches remain correct, but their cost grows with the square of the
+/// number of particles in that cluster. Use Kdtree or HyperOctree for
+/// particle distributions that are clustered on many length scales.
+///
+template <typename Traits>
+class CellListAdaptive
+    : public neighbour_search_base<CellListAdaptive<Traits>, Traits,
+                                   CellListAdaptiveQuery<Traits>> {
+
+  typedef typename Traits::double_d double_d;
+  typedef typename Traits::int_d int_d;
+  typedef typename Traits::position position;
+  typedef typename Traits::vector_unsigned_int vector_unsigned_int;
+  typedef typename Traits::unsigned_int_d unsigned_int_d;
+  typedef typename Traits::iterator iterator;
+  static const unsigned int dimension = Traits::dimension;
+
+  typedef neighbour_search_base<CellListAdaptive<Traits>, Traits,
+                                CellListAdaptiveQuery<Traits>>
+      base_type;
+
+  friend base_type;
+
+public:
+  CellListAdaptive()
+      : base_type(),
+        m_size_calculated_with_n(std::numeric_limits<size_t>::max()) {}
+
+  static constexpr bool ordered() { return true; }
+
+  ///
+  /// @brief buckets holding more than this many times the requested number of
+  /// particles per bucket are subdivided
+  ///
+  static constexpr double subdivide_ratio = 4.0;
+
+  void print_data_structure() const {
+#ifndef __CUDA_ARCH__
+    LOG(1, "\tbuckets:");
+    for (size_t i = 0; i < m_bucket_begin.size(); ++i) {
+      LOG(1, "\ti = " << i << " bucket contents = " << m_bucket_begin[i]
+                      << " to " << m_bucket_end[i]
+                      << " sub-grid size = " << m_sub_size[i]);
+    }
+    LOG(1, "\tend buckets");
+    LOG(1, "\tparticles:");
+    for (size_t i = 0; i < m_bucket_indices.size(); ++i) {
+      LOG(1, "\ti = " << i << " p = "
+                      << static_cast<const double_d &>(
+                             get<position>(*(this->m_particles_begin + i)))
+                      << " bucket = " << m_bucket_indices[i]);
+    }
+    LOG(1, "\tend particles:");
+#endif
+  }
+
+private:
+  bool set_domain_impl() {
+    const size_t n = this->m_alive_indices.size();
+    if (n < 0.5 * m_size_calculated_with_n ||
+        n > 2 * m_size_calculated_with_n) {
+      LOG(2, "CellListAdaptive: recalculating bucket size");
+      m_size_calculated_with_n = n;
+      if (this->m_n_particles_in_leaf > n) {
+        m_size = unsigned_int_d::Constant(1);
+      } else {
+        const double total_volume =
+            (this->m_bounds.bmax - this->m_bounds.bmin).prod();
+        const double box_volume =
+            this->m_n_particles_in_leaf / double(n) * total_volume;
+        const double box_side_length =
+            std::pow(box_volume, 1.0 / Traits::dimension);
+        m_size =
+            floor((this->m_bounds.bmax - this->m_bounds.bmin) / box_side_length)
+                .template cast<unsigned int>();
+        for (size_t i = 0; i < Traits::dimension; ++i) {
+          if (m_size[i] == 0) {
+            m_size[i] = 1;
+          }
+        }
+      }
+      m_bucket_side_length =
+          (this->m_bounds.bmax - this->m_bounds.bmin) / m_size;
+      m_point_to_bucket_index =
+          detail::point_to_bucket_index<Traits::dimension>(
+              m_size, m_bucket_side_length, this->m_bounds);
+
+      LOG(2, "\tbucket side length = " << m_bucket_side_length);
+      LOG(2, "\tnumber of buckets = " << m_size << " (total=" << m_size.prod()
+                                      << ")");
+
+      // setup bucket data structures
+      m_bucket_begin.resize(m_size.prod());
+      m_bucket_end.resize(m_size.prod());
+      m_sub_size.resize(m_size.prod());
+      m_sub_offset.resize(m_size.prod());
+
+      this->m_query.m_bucket_begin =
+          iterator_to_raw_pointer(m_bucket_begin.begin());
+      this->m_query.m_bucket_end =
+          iterator_to_raw_pointer(m_bucket_end.begin());
+      this->m_query.m_sub_size = iterator_to_raw_pointer(m_sub_size.begin());
+      this->m_query.m_sub_offset =
+          iterator_to_raw_pointer(m_sub_offset.begin());
+      this->m_query.m_nbuckets = m_bucket_begin.size();
+
+      this->m_query.m_bucket_side_length = m_bucket_side_length;
+      this->m_query.m_bounds.bmin = this->m_bounds.bmin;
+      this->m_query.m_bounds.bmax = this->m_bounds.bmax;
+      this->m_query.m_periodic = this->m_periodic;
+      this->m_query.m_end_bucket = m_size - 1;
+      this->m_query.m_point_to_bucket_index = m_point_to_bucket_index;
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  void update_iterator_impl() {}
+
+  void update_positions_impl(iterator update_begin, iterator update_end,
+                             const int new_n,
+                             const bool call_set_domain = true) {
+
+    ASSERT(update_begin == this->m_particles_begin &&
+               update_end == this->m_particles_end,
+           "error should be update all");
+
+    if (call_set_domain) {
+      set_domain_impl();
+    }
+
+    const size_t n = this->m_alive_indices.size();
+    m_bucket_indices.resize(n);
+    if (n > 0) {
+      // transform the points to their bucket indices
+      detail::transform(Traits::make_permutation_iterator(
+                            get<position>(this->m_particles_begin),
+                            this->m_alive_indices.begin()),
+                        Traits::make_permutation_iterator(
+                            get<position>(this->m_particles_begin),
+                            this->m_alive_indices.end()),
+                        m_bucket_indices.begin(), m_point_to_bucket_index);
+
+      // sort the points by their bucket index
+      detail::sort_by_key(m_bucket_indices.begin(), m_bucket_indices.end(),
+                          this->m_alive_indices.begin(),
+                          detail::bits_to_represent(m_size.prod() - 1));
+    }
+
+    // find the beginning of each bucket's list of points
+    auto search_begin = Traits::make_counting_iterator(0);
+    detail::lower_bound(m_bucket_indices.begin(), m_bucket_indices.end(),
+                        search_begin, search_begin + m_size.prod(),
+                        m_bucket_begin.begin());
+
+    // find the end of each bucket's list of points
+    detail::upper_bound(m_bucket_indices.begin(), m_bucket_indices.end(),
+                        search_begin, search_begin + m_size.prod(),
+                        m_bucket_end.begin());
+
+    subdivide_buckets();
+
+#ifndef __CUDA_ARCH__
+    if (4 <= ABORIA_LOG_LEVEL) {
+      print_data_structure();
+    }
+#endif
+  }
+
+  ///
+  /// @brief sets up a sub-grid for each over-full bucket, and sorts the
+  /// particles in that bucket by sub-bucket
+  ///
+  void subdivide_buckets() {
+    const size_t nbuckets = m_bucket_begin.size();
+    const double max_bucket_size =
+        subdivide_ratio * this->m_n_particles_in_leaf;
+
+    // choose the size of each sub-grid and its offset into m_sub_begin.
+    // Each sub-grid stores the beginning of each sub-bucket, plus the end of
+    // the last
+    m_subdivided.clear();
+    size_t total = 0;
+    for (size_t b = 0; b < nbuckets; ++b) {
+      const unsigned int count = m_bucket_end[b] - m_bucket_begin[b];
+      if (count > max_bucket_size) {
+        const unsigned int s = static_cast<unsigned int>(
+            std::ceil(std::pow(count / this->m_n_particles_in_leaf,
+                               1.0 / dimension)));
+        m_sub_size[b] = s;
+        m_sub_offset[b] = total;
+        total += CellListAdaptiveQuery<Traits>::sub_grid_size(s) + 1;
+        m_subdivided.push_back(b);
+      } else {
+        m_sub_size[b] = 0;
+      }
+    }
+    LOG(2, "CellListAdaptive: subdividing " << m_subdivided.size() << " of "
+                                            << nbuckets << " buckets");
+
+    m_sub_begin.resize(total);
+    m_sub_indices.resize(m_bucket_indices.size());
+    m_sub_scratch.resize(m_bucket_indices.size());
+    this->m_query.m_sub_begin = iterator_to_raw_pointer(m_sub_begin.begin());
+
+    const int nsubdivided = m_subdivided.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < nsubdivided; ++i) {
+      sort_bucket(m_subdivided[i]);
+    }
+  }
+
+  ///
+  /// @brief counting sort of the particles in bucket @p b by their sub-bucket
+  /// index. This also fills in the beginning of each sub-bucket
+  ///
+  void sort_bucket(const unsigned int b) {
+    const CellListAdaptiveQuery<Traits> &query = this->m_query;
+    const unsigned int begin = m_bucket_begin[b];
+    const unsigned int end = m_bucket_end[b];
+    const int s = m_sub_size[b];
+    const int nsub = CellListAdaptiveQuery<Traits>::sub_grid_size(s);
+    unsigned int *sub_begin =
+        iterator_to_raw_pointer(m_sub_begin.begin()) + m_sub_offset[b];
+    auto positions = get<position>(this->m_particles_begin);
+    const int_d bucket = m_point_to_bucket_index.find_bucket_index_vector(
+        positions[this->m_alive_indices[begin]]);
+
+    // count the particles in each sub-bucket
+    std::fill(sub_begin, sub_begin + nsub + 1, 0);
+    for (unsigned int k = begin; k < end; ++k) {
+      const int sub = query.collapse_sub_index(
+          query.find_sub_bucket_index_vector(
+              bucket, s, positions[this->m_alive_indices[k]]),
+          s);
+      m_sub_indices[k] = sub;
+      ++sub_begin[sub + 1];
+    }
+
+    // sub_begin[j] becomes the start of sub-bucket j
+    for (int j = 0; j < nsub; ++j) {
+      sub_begin[j + 1] += sub_begin[j];
+    }
+
+    // scatter the particles, which leaves sub_begin[j] at the end of
+    // sub-bucket j
+    for (unsigned int k = begin; k < end; ++k) {
+      m_sub_scratch[begin + sub_begin[m_sub_indices[k]]++] =
+          this->m_alive_indices[k];
+    }
+    std::copy(m_sub_scratch.begin() + begin, m_sub_scratch.begin() + end,
+              this->m_alive_indices.begin() + begin);
+
+    for (int j = nsub; j > 0; --j) {
+      sub_begin[j] = begin + sub_begin[j - 1];
+    }
+    sub_begin[0] = begin;
+  }
+
+  const CellListAdaptiveQuery<Traits> &get_query_impl() const {
+    return m_query;
+  }
+
+  CellListAdaptiveQuery<Traits> &get_query_impl() { return m_query; }
+
+  // the grid data structure keeps a range per grid bucket:
+  // each bucket_begin[i] indexes the first element of bucket i's list of points
+  // each bucket_end[i] indexes one past the last element of bucket i's list of
+  // points
+  vector_unsigned_int m_bucket_begin;
+  vector_unsigned_int m_bucket_end;
+  vector_unsigned_int m_bucket_indices;
+
+  // each subdivided bucket i has a sub-grid with sub_size[i] sub-buckets along
+  // each side (sub_size[i] == 0 if the bucket is not subdivided). The beginning
+  // of each of these sub-buckets, plus the end of the last, are stored in
+  // sub_begin, starting at sub_offset[i]
+  vector_unsigned_int m_sub_size;
+  vector_unsigned_int m_sub_offset;
+  vector_unsigned_int m_sub_begin;
+
+  // temporary storage for the subdivision
+  std::vector<unsigned int> m_subdivided;
+  std::vector<int> m_sub_indices;
+  std::vector<int> m_sub_scratch;
+
+  CellListAdaptiveQuery<Traits> m_query;
+
+  double_d m_bucket_side_length;
+  unsigned_int_d m_size;
+  size_t m_size_calculated_with_n;
+  detail::point_to_bucket_index<Traits::dimension> m_point_to_bucket_index;
+};
+
+///
+/// @brief a bucket of the CellListAdaptive data structure. This is the index
+/// of the top-level bucket, along with the index of a sub-bucket within it
+///
+template <unsigned int D> struct adaptive_bucket : public Vector<int, D> {
+  typedef Vector<int, D> int_d;
+
+  ///
+  /// @brief index of the sub-bucket within a subdivided bucket, or -1 for
+  /// the whole bucket
+  ///
+  int sub;
+
+  CUDA_HOST_DEVICE
+  adaptive_bucket() : int_d(), sub(-1) {}
+
+  CUDA_HOST_DEVICE
+  adaptive_bucket(const int_d &index, const int sub = -1)
+      : int_d(index), sub(sub) {}
+};
+
+///
+/// @brief iterates over the buckets of a CellListAdaptive that are within a
+/// given distance of a point, descending into the sub-grid of any subdivided
+/// bucket. Empty sub-buckets are skipped
+///
+/// @tparam Query the query type (CellListAdaptiveQuery)
+/// @tparam LNormNumber the norm used to measure distance
+///
+template <typename Query, int LNormNumber>
+class adaptive_lattice_iterator_within_distance {
+  typedef adaptive_lattice_iterator_within_distance<Query, LNormNumber>
+      iterator;
+  typedef lattice_iterator_within_distance<Query, LNormNumber> top_iterator;
+  static const unsigned int dimension = Query::dimension;
+  typedef Vector<double, dimension> double_d;
+  typedef Vector<int, dimension> int_d;
+
+public:
+  typedef adaptive_bucket<dimension> value_type;
+  typedef const value_type *pointer;
+  typedef std::forward_iterator_tag iterator_category;
+  typedef const value_type &reference;
+  typedef std::ptrdiff_t difference_type;
+
+  CUDA_HOST_DEVICE
+  adaptive_lattice_iterator_within_distance() {}
+
+  CUDA_HOST_DEVICE
+  adaptive_lattice_iterator_within_distance(const double_d &query_point,
+                                            const double_d &max_distance,
+                                            const Query *query)
+      : m_top(query_point, max_distance, query), m_query(query),
+        m_query_point(query_point), m_max_distance(max_distance),
+        m_inv_max_distance(1.0 / max_distance), m_sub_size(0) {
+    find_bucket();
+  }
+
+  CUDA_HOST_DEVICE
+  explicit operator size_t() const {
+    return m_query->m_point_to_bucket_index.collapse_index_vector(m_bucket);
+  }
+
+  lattice_iterator<dimension> get_child_iterator() const {
+    return m_top.get_child_iterator();
+  }
+
+  CUDA_HOST_DEVICE
+  reference operator*() const { return m_bucket; }
+
+  CUDA_HOST_DEVICE
+  pointer operator->() const { return &m_bucket; }
+
+  CUDA_HOST_DEVICE
+  iterator &operator++() {
+    increment();
+    return *this;
+  }
+
+  CUDA_HOST_DEVICE
+  iterator operator++(int) {
+    iterator tmp(*this);
+    operator++();
+    return tmp;
+  }
+
+  CUDA_HOST_DEVICE
+  size_t operator-(const iterator &start) const {
+    int distance = 0;
+    iterator tmp = start;
+    while (tmp != *this) {
+      ++distance;
+      ++tmp;
+    }
+    return distance;
+  }
+
+  CUDA_HOST_DEVICE
+  inline bool operator==(const iterator &rhs) const {
+    if (m_top != rhs.m_top) {
+      return false;
+    }
+    return m_top == false || m_bucket.sub == rhs.m_bucket.sub;
+  }
+
+  CUDA_HOST_DEVICE
+  inline bool operator==(const bool rhs) const { return m_top == rhs; }
+
+  CUDA_HOST_DEVICE
+  inline bool operator!=(const iterator &rhs) const { return !operator==(rhs); }
+
+  CUDA_HOST_DEVICE
+  inline bool operator!=(const bool rhs) const { return !operator==(rhs); }
+
+private:
+  CUDA_HOST_DEVICE
+  void increment() {
+    if (m_sub_size > 0) {
+      ++m_sub;
+      if (find_sub_bucket()) {
+        return;
+      }
+    }
+    ++m_top;
+    find_bucket();
+  }
+
+  ///
+  /// @brief moves #m_top to the next top-level bucket that is either not
+  /// subdivided, or has a non-empty sub-bucket within range
+  ///
+  CUDA_HOST_DEVICE
+  void find_bucket() {
+    for (; m_top != false; ++m_top) {
+      const int_d &bucket = *m_top;
+      const unsigned int bucket_index =
+          m_query->m_point_to_bucket_index.collapse_index_vector(bucket);
+      m_sub_size = m_query->m_sub_size[bucket_index];
+      if (m_sub_size == 0) {
+        m_bucket = value_type(bucket);
+        return;
+      }
+      m_sub_offset = m_query->m_sub_offset[bucket_index];
+
+      // only look at the sub-buckets overlapping the search box
+      int_d min = m_query->find_sub_bucket_index_vector(
+          bucket, m_sub_size, m_query_point - m_max_distance);
+      int_d max = m_query->find_sub_bucket_index_vector(
+          bucket, m_sub_size, m_query_point + m_max_distance);
+      m_sub = lattice_iterator<dimension>(min, max + 1);
+      m_bucket = value_type(bucket);
+      if (find_sub_bucket()) {
+        return;
+      }
+    }
+  }
+
+  ///
+  /// @brief moves #m_sub to the next non-empty sub-bucket within range
+  ///
+  CUDA_HOST_DEVICE
+  bool find_sub_bucket() {
+    for (; m_sub != false; ++m_sub) {
+      const int_d &sub = *m_sub;
+      const bbox<dimension> bounds =
+          m_query->get_sub_bucket_bbox(m_bucket, m_sub_size, sub);
+      double accum = 0;
+      for (size_t j = 0; j < dimension; ++j) {
+        double dist = 0;
+        if (m_query_point[j] < bounds.bmin[j]) {
+          dist = bounds.bmin[j] - m_query_point[j];
+        } else if (m_query_point[j] > bounds.bmax[j]) {
+          dist = m_query_point[j] - bounds.bmax[j];
+        }
+        accum = detail::distance_helper<LNormNumber>::accumulate_norm(
+            accum, dist * m_inv_max_distance[j]);
+      }
+      if (accum > 1.0) {
+        continue;
+      }
+      const int sub_index = m_query->collapse_sub_index(sub, m_sub_size);
+      const unsigned int *sub_begin = m_query->m_sub_begin + m_sub_offset;
+      if (sub_begin[sub_index] == sub_begin[sub_index + 1]) {
+        continue;
+      }
+      m_bucket.sub = sub_index;
+      return true;
+    }
+    return false;
+  }
+
+  top_iterator m_top;
+  const Query *m_query;
+  double_d m_query_point;
+  double_d m_max_distance;
+  double_d m_inv_max_distance;
+  lattice_iterator<dimension> m_sub;
+  int m_sub_size;
+  unsigned int m_sub_offset;
+  value_type m_bucket;
+};
+
+/// @copydetails NeighbourQueryBase
+///
+/// @brief This is a query object for the CellListAdaptive spatial data
+/// structure
+///
+template <typename Traits>
+struct CellListAdaptiveQuery : public NeighbourQueryBase<Traits> {
+
+  typedef Traits traits_type;
+  typedef typename Traits::raw_pointer raw_pointer;
+  typedef typename Traits::double_d double_d;
+  typedef typename Traits::bool_d bool_d;
+  typedef typename Traits::int_d int_d;
+  typedef typename Traits::unsigned_int_d unsigned_int_d;
+  const static unsigned int dimension = Traits::dimension;
+  template <int LNormNumber>
+  using query_iterator =
+      adaptive_lattice_iterator_within_distance<CellListAdaptiveQuery,
+                                                LNormNumber>;
+  typedef lattice_iterator<dimension> all_iterator;
+  typedef lattice_iterator<dimension> child_iterator;
+  typedef typename query_iterator<2>::reference reference;
+  typedef typename query_iterator<2>::pointer pointer;
+  typedef typename query_iterator<2>::value_type value_type;
+  typedef ranges_iterator<Traits> particle_iterator;
+  typedef bbox<dimension> box_type;
+
+  ///
+  /// @brief pointer to the beginning of the particle set
+  ///
+  raw_pointer m_particles_begin;
+
+  ///
+  /// @brief pointer to the end of the particle set
+  ///
+  raw_pointer m_particles_end;
+
+  ///
+  /// @brief periodicity of the domain
+  ///
+  bool_d m_periodic;
+
+  ///
+  /// @brief dimensions of each top-level bucket
+  ///
+  double_d m_bucket_side_length;
+
+  ///
+  /// @brief index of the last bucket in the cell list
+  ///
+  int_d m_end_bucket;
+
+  ///
+  /// @brief min/max bounds of the domain
+  ///
+  bbox<dimension> m_bounds;
+
+  ///
+  /// @brief function object to transform a point to a bucket index
+  ///
+  detail::point_to_bucket_index<dimension> m_point_to_bucket_index;
+
+  ///
+  /// @brief pointer to the beginning of the buckets
+  ///
+  unsigned int *m_bucket_begin;
+
+  ///
+  /// @brief pointer to the end of the buckets
+  ///
+  unsigned int *m_bucket_end;
+
+  ///
+  /// @brief pointer to the number of sub-buckets along each side of each
+  /// bucket's sub-grid (0 if the bucket is not subdivided)
+  ///
+  unsigned int *m_sub_size;
+
+  ///
+  /// @brief pointer to the offset of each bucket's sub-grid in #m_sub_begin
+  ///
+  unsigned int *m_sub_offset;
+
+  ///
+  /// @brief pointer to the beginning of the sub-buckets
+  ///
+  unsigned int *m_sub_begin;
+
+  ///
+  /// @brief the number of buckets
+  ///
+  unsigned int m_nbuckets;
+
+  ///
+  /// @brief a pointer to the "key" values of the find-by-id map
+  ///
+  size_t *m_id_map_key;
+
+  ///
+  /// @brief a pointer to the "value" values of the find-by-id map
+  ///
+  size_t *m_id_map_value;
+
+  ///
+  /// @brief the size of the dense find-by-id map, or zero if it is sorted
+  ///
+  size_t m_id_map_dense_size;
+
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  CellListAdaptiveQuery() {}
+
+  /*
+   * functions for id mapping
+   */
+
+  ///
+  /// @copydoc NeighbourQueryBase::find()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  raw_pointer find(const size_t id) const {
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
+  }
+
+  /*
+   * functions for the sub-grids
+   */
+
+  ///
+  /// @brief returns the index of the sub-bucket containing @p position,
+  /// within the sub-grid of @p bucket that has @p sub_size sub-buckets along
+  /// each side. The index is clamped to the sub-grid
+  ///
+  CUDA_HOST_DEVICE
+  int_d find_sub_bucket_index_vector(const int_d &bucket, const int sub_size,
+                                     const double_d &position) const {
+    int_d sub;
+    for (size_t i = 0; i < dimension; ++i) {
+      const double bucket_min =
+          bucket[i] * m_bucket_side_length[i] + m_bounds.bmin[i];
+      const double index = std::floor((position[i] - bucket_min) * sub_size /
+                                      m_bucket_side_length[i]);
+      sub[i] = index < 0 ? 0 : (index >= sub_size ? sub_size - 1 : index);
+    }
+    return sub;
+  }
+
+  ///
+  /// @brief returns the number of sub-buckets in a sub-grid with @p sub_size
+  /// sub-buckets along each side
+  ///
+  CUDA_HOST_DEVICE
+  static int sub_grid_size(const int sub_size) {
+    int size = 1;
+    for (size_t i = 0; i < dimension; ++i) {
+      size *= sub_size;
+    }
+    return size;
+  }
+
+  ///
+  /// @brief collapses the vector index @p sub of a sub-bucket into an index
+  /// within the sub-grid
+  ///
+  CUDA_HOST_DEVICE
+  static int collapse_sub_index(const int_d &sub, const int sub_size) {
+    int index = 0;
+    for (size_t i = 0; i < dimension; ++i) {
+      index = index * sub_size + sub[i];
+    }
+    return index;
+  }
+
+  ///
+  /// @brief returns the bounding box of sub-bucket @p sub within the sub-grid
+  /// of @p bucket
+  ///
+  CUDA_HOST_DEVICE
+  box_type get_sub_bucket_bbox(const int_d &bucket, const int sub_size,
+                               const int_d &sub) const {
+    const double_d sub_side_length = m_bucket_side_length / sub_size;
+    const double_d bucket_min = bucket * m_bucket_side_length + m_bounds.bmin;
+    return box_type(bucket_min + sub * sub_side_length,
+                    bucket_min + (sub + 1) * sub_side_length);
+  }
+
+  /*
+   * functions for trees
+   */
+
+  ///
+  /// @copydoc NeighbourQueryBase::is_leaf_node()
+  ///
+  /// always true for CellListAdaptive
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  static bool is_leaf_node(const value_type &bucket) { return true; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::is_tree()
+  ///
+  /// always false for CellListAdaptive
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  static bool is_tree() { return false; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_children() const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  child_iterator get_children() const {
+    return child_iterator(int_d::Constant(0), m_end_bucket + 1);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_children(const child_iterator&) const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  child_iterator get_children(const child_iterator &ci) const {
+    return child_iterator();
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::num_children(const child_iterator&) const
+  ///
+  static size_t num_children(const child_iterator &ci) { return 0; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::num_children() const
+  ///
+  size_t num_children() const { return number_of_buckets(); }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bounds()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const box_type get_bounds(const child_iterator &ci) const {
+    box_type bounds;
+    bounds.bmin = (*ci) * m_bucket_side_length + m_bounds.bmin;
+    bounds.bmax = ((*ci) + 1) * m_bucket_side_length + m_bounds.bmin;
+    return bounds;
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bounds()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const box_type &get_bounds() const { return m_bounds; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_periodic()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const bool_d &get_periodic() const { return m_periodic; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket_particles()
+  ///
+  /// If @p bucket is a plain top-level bucket index, this returns all the
+  /// particles in that bucket
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  particle_iterator get_bucket_particles(const reference bucket) const {
+#ifndef __CUDA_ARCH__
+    ASSERT((bucket >= int_d::Constant(0)).all() &&
+               (bucket <= m_end_bucket).all(),
+           "invalid bucket");
+#endif
+
+    const unsigned int bucket_index =
+        m_point_to_bucket_index.collapse_index_vector(bucket);
+    unsigned int range_start_index;
+    unsigned int range_end_index;
+    if (bucket.sub < 0) {
+      range_start_index = m_bucket_begin[bucket_index];
+      range_end_index = m_bucket_end[bucket_index];
+    } else {
+      const unsigned int *sub_begin =
+          m_sub_begin + m_sub_offset[bucket_index] + bucket.sub;
+      range_start_index = sub_begin[0];
+      range_end_index = sub_begin[1];
+    }
+
+#ifndef __CUDA_ARCH__
+    LOG(4, "\tlooking in bucket "
+               << bucket << " = " << bucket_index << " (sub-bucket "
+               << bucket.sub << "). found "
+               << range_end_index - range_start_index << " particles");
+#endif
+    return particle_iterator(m_particles_begin + range_start_index,
+                             m_particles_begin + range_end_index);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket_bbox()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  bbox<dimension> get_bucket_bbox(const reference bucket) const {
+    if (bucket.sub < 0) {
+      return bbox<dimension>(bucket * m_bucket_side_length + m_bounds.bmin,
+                             (bucket + 1) * m_bucket_side_length +
+                                 m_bounds.bmin);
+    }
+    const int sub_size =
+        m_sub_size[m_point_to_bucket_index.collapse_index_vector(bucket)];
+    int_d sub;
+    int index = bucket.sub;
+    for (int i = dimension - 1; i >= 0; --i) {
+      sub[i] = index % sub_size;
+      index /= sub_size;
+    }
+    return get_sub_bucket_bbox(bucket, sub_size, sub);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  child_iterator get_bucket(const double_d &position) const {
+    auto bucket = m_point_to_bucket_index.find_bucket_index_vector(position);
+    return child_iterator(bucket, bucket + 1);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket_index()
+  ///
+  /// This is the index of the top-level bucket
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  size_t get_bucket_index(const reference bucket) const {
+    return m_point_to_bucket_index.collapse_index_vector(bucket);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_buckets_near_point()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  template <int LNormNumber = -1>
+  CUDA_HOST_DEVICE query_iterator<LNormNumber>
+  get_buckets_near_point(const double_d &position,
+                         const double max_distance) const {
+#ifndef __CUDA_ARCH__
+    LOG(4, "\tget_buckets_near_point: position = "
+               << position << " max_distance = " << max_distance);
+#endif
+    return query_iterator<LNormNumber>(position,
+                                       double_d::Constant(max_distance), this);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_buckets_near_point()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  template <int LNormNumber = -1>
+  CUDA_HOST_DEVICE query_iterator<LNormNumber>
+  get_buckets_near_point(const double_d &position,
+                         const double_d &max_distance) const {
+#ifndef __CUDA_ARCH__
+    LOG(4, "\tget_buckets_near_point: position = "
+               << position << " max_distance = " << max_distance);
+#endif
+    return query_iterator<LNormNumber>(position, max_distance, this);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_end_bucket()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const int_d &get_end_bucket() const { return m_end_bucket; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_subtree(const child_iterator&) const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  all_iterator get_subtree(const child_iterator &ci) const {
+    return all_iterator();
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_subtree() const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  all_iterator get_subtree() const {
+    return all_iterator(int_d::Constant(0), m_end_bucket + 1);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::number_of_buckets()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  size_t number_of_buckets() const { return (m_end_bucket + 1).prod(); }
+
+  ///
+  /// @copydoc NeighbourQueryBase::number_of_particles()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  size_t number_of_particles() const {
+    return (m_particles_end - m_particles_begin);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_particles_begin() const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const raw_pointer &get_particles_begin() const { return m_particles_begin; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_particles_begin()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  raw_pointer &get_particles_begin() { return m_particles_begin; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::number_of_levels()
+  ///
+  /// always 2 for CellListAdaptive
+  ///
+  unsigned number_of_levels() const { return 2; }
+};
+
+} // namespace Aboria
+
+#endif /* CELL_LIST_ADAPTIVE_H_ */
@@ -102,7 +102,7 @@ class CellListOrdered
 
 public:
   CellListOrdered()
-      : base_type(),
+      : base_type(), m_order_changed(true),
         m_size_calculated_with_n(std::numeric_limits<size_t>::max()) {}
 
   static constexpr bool ordered() { return true; }
@@ -167,6 +167,10 @@ private:
       m_bucket_begin.resize(m_size.prod());
       m_bucket_end.resize(m_size.prod());
 
+      // the previous bucket indices are no longer valid, so the next update
+      // can't be incremental
+      m_bucket_indices.clear();
+
       this->m_query.m_bucket_begin =
           iterator_to_raw_pointer(m_bucket_begin.begin());
       this->m_query.m_bucket_end =
@@ -200,8 +204,29 @@ private:
     }
 
     const size_t n = this->m_alive_indices.size();
-    m_bucket_indices.resize(n);
-    if (n > 0) {
+    m_order_changed = true;
+
+    // if there are no new or dead particles then m_alive_indices is the
+    // sequence 0..n-1, and the particles are still sorted by the previous
+    // bucket indices, so can try the incremental update
+    const bool incremental =
+        detail::is_std_iterator<vector_unsigned_int_iterator>::type::value &&
+        n > 0 && m_bucket_indices.size() == n &&
+        static_cast<size_t>(update_end - update_begin) == n;
+
+    if (incremental && update_positions_incremental()) {
+      if (!m_order_changed) {
+        LOG(2, "CellListOrdered: no particles changed bucket");
+        return;
+      }
+    } else if (incremental) {
+      // too many particles changed bucket, the new bucket indices have been
+      // calculated already so sort them
+      detail::sort_by_key(m_bucket_indices.begin(), m_bucket_indices.end(),
+                          this->m_alive_indices.begin(),
+                          detail::bits_to_represent(m_size.prod() - 1));
+    } else if (n > 0) {
+      m_bucket_indices.resize(n);
       // transform the points to their bucket indices
       if (static_cast<size_t>(update_end - update_begin) == n) {
         // m_alive_indicies is just a sequential list of indices
@@ -224,7 +249,10 @@ private:
 
       // sort the points by their bucket index
       detail::sort_by_key(m_bucket_indices.begin(), m_bucket_indices.end(),
-                          this->m_alive_indices.begin());
+                          this->m_alive_indices.begin(),
+                          detail::bits_to_represent(m_size.prod() - 1));
+    } else {
+      m_bucket_indices.clear();
     }
 
     // find the beginning of each bucket's list of points
@@ -258,6 +286,82 @@ private:
 #endif
   }
 
+  ///
+  /// @brief updates the bucket indices and order of the particles when all
+  /// the particles are still sorted by their previous bucket indices (i.e. no
+  /// particles have been added or deleted)
+  ///
+  /// The particles that stay in their bucket are still sorted, so only the
+  /// particles that have changed bucket need to be sorted, after which the two
+  /// sorted lists are merged. The result is the same order as a stable sort of
+  /// all the particles by bucket index.
+  ///
+  /// @return false if more than #max_incremental_fraction of the particles
+  /// have changed bucket, in which case #m_bucket_indices holds the new
+  /// (unsorted) bucket indices, which still need to be sorted along with
+  /// #m_alive_indices. Otherwise returns true, and sets #m_order_changed to
+  /// false if no particles have changed bucket
+  ///
+  bool update_positions_incremental() {
+    const size_t n = m_bucket_indices.size();
+    auto positions = get<position>(this->m_particles_begin);
+    m_new_bucket_indices.resize(n);
+    detail::transform(positions, positions + n, m_new_bucket_indices.begin(),
+                      m_point_to_bucket_index);
+
+    // find the particles that have changed bucket
+    m_moved_indices.clear();
+    for (size_t i = 0; i < n; ++i) {
+      if (m_new_bucket_indices[i] != m_bucket_indices[i]) {
+        m_moved_indices.push_back(i);
+      }
+    }
+    const size_t n_moved = m_moved_indices.size();
+    LOG(2, "CellListOrdered: " << n_moved << " of " << n
+                               << " particles changed bucket");
+
+    if (n_moved == 0) {
+      m_order_changed = false;
+      return true;
+    }
+
+    if (n_moved > max_incremental_fraction * n) {
+      m_bucket_indices.swap(m_new_bucket_indices);
+      return false;
+    }
+
+    // sort the moved particles by their new bucket index, then merge these
+    // with the particles that stayed put. Ties are broken by the original
+    // index so the result matches a stable sort
+    const vector_unsigned_int &new_index = m_new_bucket_indices;
+    const vector_unsigned_int &old_index = m_bucket_indices;
+    auto less = [&](const int a, const int b) {
+      return new_index[a] < new_index[b] ||
+             (new_index[a] == new_index[b] && a < b);
+    };
+    std::sort(m_moved_indices.begin(), m_moved_indices.end(), less);
+
+    size_t i = 0;
+    size_t j = 0;
+    for (size_t k = 0; k < n; ++k) {
+      while (i < n && new_index[i] != old_index[i]) {
+        ++i;
+      }
+      if (j < n_moved && (i == n || less(m_moved_indices[j], i))) {
+        this->m_alive_indices[k] = m_moved_indices[j++];
+      } else {
+        this->m_alive_indices[k] = i++;
+      }
+    }
+
+    for (size_t k = 0; k < n; ++k) {
+      m_bucket_indices[k] = new_index[this->m_alive_indices[k]];
+    }
+    return true;
+  }
+
+  bool order_changed_impl() const { return m_order_changed; }
+
   const CellListOrderedQuery<Traits> &get_query_impl() const { return m_query; }
 
   CellListOrderedQuery<Traits> &get_query_impl() { return m_query; }
@@ -271,6 +375,18 @@ private:
   vector_unsigned_int m_bucket_indices;
   CellListOrderedQuery<Traits> m_query;
 
+  ///
+  /// @brief if more than this fraction of the particles change bucket during
+  /// an update then all the particles are re-sorted, rather than merging the
+  /// particles that moved into the existing order
+  ///
+  static constexpr double max_incremental_fraction = 0.1;
+
+  // temporary storage for the incremental update
+  vector_unsigned_int m_new_bucket_indices;
+  std::vector<int> m_moved_indices;
+  bool m_order_changed;
+
   double_d m_bucket_side_length;
   unsigned_int_d m_size;
   size_t m_size_calculated_with_n;
@@ -362,6 +478,11 @@ struct CellListOrderedQuery : public NeighbourQueryBase<Traits> {
   ///
   size_t *m_id_map_value;
 
+  ///
+  /// @brief the size of the dense find-by-id map, or zero if it is sorted
+  ///
+  size_t m_id_map_dense_size;
+
   ABORIA_HOST_DEVICE_IGNORE_WARN
   CUDA_HOST_DEVICE
   CellListOrderedQuery() {}
@@ -376,14 +497,10 @@ struct CellListOrderedQuery : public NeighbourQueryBase<Traits> {
   ABORIA_HOST_DEVICE_IGNORE_WARN
   CUDA_HOST_DEVICE
   raw_pointer find(const size_t id) const {
-    const size_t n = number_of_particles();
-    size_t *last = m_id_map_key + n;
-    size_t *first = detail::lower_bound(m_id_map_key, last, id);
-    if ((first != last) && !(id < *first)) {
-      return m_particles_begin + m_id_map_value[first - m_id_map_key];
-    } else {
-      return m_particles_begin + n;
-    }
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
   }
 
   /*
@@ -181,8 +181,7 @@ public:
     // overwrite id, alive and random generator
     reference i = *(end() - 1);
     Aboria::get<id>(i) = this->m_next_id++;
-    Aboria::get<generator>(i) =
-        generator_type((m_seed + uint32_t(Aboria::get<id>(i))));
+    detail::seed_generator(i, m_seed);
     Aboria::get<alive>(i) = true;
 
     push_connections(end() - 1, end());
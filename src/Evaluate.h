@@ -80,6 +80,9 @@ void evaluate_nonlinear(ExprRHS const &expr, LabelType &label) {
         functor(get<VariableType>(particles)[i], eval(expr, particles[i]));
   }
 
+  // any random terminals draw from fresh streams in the next evaluation
+  particles.next_random_step();
+
   // if aliased then copy back from the buffer
   if (not_aliased::value == false) {
     const size_t n = particles.size();
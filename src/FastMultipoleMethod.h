@@ -82,6 +82,20 @@ protected:
   mutable l_storage_type m_g;
   mutable connectivity_type m_connectivity;
 
+#ifdef HAVE_EIGEN
+  // low-rank M2L operators, shared between all box pairs with the same
+  // geometry and rebuilt if either particle set is updated
+  typedef detail::M2LMatrixCache<
+      dimension, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>>
+      m2l_cache_type;
+  mutable m2l_cache_type m_m2l_cache;
+  mutable bool m_m2l_cache_valid;
+  mutable size_t m_m2l_cache_row_update_count;
+  mutable size_t m_m2l_cache_col_update_count;
+  double m_m2l_tolerance;
+  bool m_m2l_translation_invariant;
+#endif
+
   const ColParticles *m_col_particles;
   const RowParticles *m_row_particles;
   const col_query_type *m_col_query;
@@ -94,7 +108,13 @@ public:
   FastMultipoleMethod(const RowParticles &row_particles,
                       const ColParticles &col_particles,
                       const Expansions &expansions, const Kernel &kernel)
-      : m_col_particles(&col_particles), m_row_particles(&row_particles),
+      :
+#ifdef HAVE_EIGEN
+        m_m2l_cache_valid(false), m_m2l_cache_row_update_count(0),
+        m_m2l_cache_col_update_count(0), m_m2l_tolerance(0),
+        m_m2l_translation_invariant(false),
+#endif
+        m_col_particles(&col_particles), m_row_particles(&row_particles),
         m_col_query(&col_particles.get_query()),
         m_row_query(&row_particles.get_query()), m_expansions(expansions),
         m_kernel(kernel),
@@ -106,6 +126,26 @@ public:
   {
   }
 
+#ifdef HAVE_EIGEN
+  /// Enables compression of the M2L operators if @p tolerance is positive.
+  ///
+  /// The M2L operator for each weakly connected box pair is precomputed and
+  /// stored as a low-rank factorisation $UV$ (using adaptive cross
+  /// approximation) with relative error @p tolerance, and then applied as
+  /// $U(Vx)$ rather than evaluating the kernel between all pairs of Chebyshev
+  /// nodes. If @p translation_invariant is true the kernel is assumed to
+  /// depend only on the difference between the two positions, and a single
+  /// operator is shared between all box pairs with the same sizes and
+  /// relative position. The operators are recalculated on the next
+  /// matrix_vector_multiply() if either particle set has been updated
+  void set_m2l_compression(const double tolerance,
+                           const bool translation_invariant = false) {
+    m_m2l_tolerance = tolerance;
+    m_m2l_translation_invariant = translation_invariant;
+    m_m2l_cache_valid = false;
+  }
+#endif
+
   // target_vector += A*source_vector
   template <typename VectorTypeTarget, typename VectorTypeSource>
   void matrix_vector_multiply(VectorTypeTarget &target_vector,
@@ -115,6 +155,11 @@ public:
     m_W.resize(m_col_query->number_of_buckets());
     m_g.resize(m_row_query->number_of_buckets());
     m_connectivity.resize(m_row_query->number_of_buckets());
+#ifdef HAVE_EIGEN
+    if (m_m2l_tolerance > 0) {
+      update_m2l_cache();
+    }
+#endif
 
 // upward sweep of tree
 //
@@ -167,6 +212,92 @@ shared(target_vector, source_vector, m_num_tasks, m_W, m_g, m_col_query,   \
   }
 
 private:
+  void calculate_M2L(l_expansion_type &g, const box_type &target_box,
+                     const box_type &source_box,
+                     const m_expansion_type &W) const {
+#ifdef HAVE_EIGEN
+    if (m_m2l_tolerance > 0) {
+      Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 1>> g_map(
+          reinterpret_cast<double *>(g.data()),
+          g.size() * Expansions::block_rows);
+      Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 1>> W_map(
+          reinterpret_cast<const double *>(W.data()),
+          W.size() * Expansions::block_cols);
+      m_m2l_cache.apply(m_m2l_cache.find(target_box, source_box), g_map,
+                        W_map);
+      return;
+    }
+#endif
+    m_expansions.M2L(g, target_box, source_box, W);
+  }
+
+#ifdef HAVE_EIGEN
+  void update_m2l_cache() const {
+    const size_t row_update_count = m_row_particles->get_update_count();
+    const size_t col_update_count = m_col_particles->get_update_count();
+    if (m_m2l_cache_valid &&
+        row_update_count == m_m2l_cache_row_update_count &&
+        col_update_count == m_m2l_cache_col_update_count) {
+      return;
+    }
+    LOG(2, "FastMultipoleMethod: generating compressed M2L operators");
+    m_m2l_cache.clear(m_col_query->get_bounds(), m_m2l_translation_invariant);
+    m_m2l_cache.set_compression(m_m2l_tolerance);
+    for (row_child_iterator ci = m_row_query->get_children(); ci != false;
+         ++ci) {
+      insert_m2l_pairs(col_child_iterator_vector_type(), ci);
+    }
+    m_m2l_cache.generate(m_expansions);
+    LOG(2, "\tusing " << m_m2l_cache.size()
+                      << " M2L operators, average rank "
+                      << m_m2l_cache.average_rank());
+    m_m2l_cache_valid = true;
+    m_m2l_cache_row_update_count = row_update_count;
+    m_m2l_cache_col_update_count = col_update_count;
+  }
+
+  // same traversal as calculate_dive_M2L_and_L2L, but only inserts the
+  // weakly connected box pairs into the M2L cache
+  void insert_m2l_pairs(
+      const col_child_iterator_vector_type &connected_buckets_parent,
+      const row_child_iterator &ci) const {
+    const box_type &target_box = m_row_query->get_bounds(ci);
+    col_child_iterator_vector_type connected_buckets;
+    detail::theta_condition<dimension> theta(target_box.bmin, target_box.bmax);
+    auto check_source = [&](const col_child_iterator &cj) {
+      const box_type &source_box = m_col_query->get_bounds(cj);
+      if (theta.check(source_box.bmin, source_box.bmax)) {
+        connected_buckets.push_back(cj);
+      } else {
+        m_m2l_cache.insert(target_box, source_box);
+      }
+    };
+    if (connected_buckets_parent.empty()) {
+      for (col_child_iterator cj = m_col_query->get_children(); cj != false;
+           ++cj) {
+        check_source(cj);
+      }
+    } else {
+      for (const col_child_iterator &source : connected_buckets_parent) {
+        if (m_col_query->is_leaf_node(*source)) {
+          connected_buckets.push_back(source);
+        } else {
+          for (col_child_iterator cj = m_col_query->get_children(source);
+               cj != false; ++cj) {
+            check_source(cj);
+          }
+        }
+      }
+    }
+    if (!m_row_query->is_leaf_node(*ci)) {
+      for (row_child_iterator cj = m_row_query->get_children(ci); cj != false;
+           ++cj) {
+        insert_m2l_pairs(connected_buckets, cj);
+      }
+    }
+  }
+#endif
+
   template <typename VectorType>
   m_expansion_type &calculate_dive_P2M_and_M2M(const col_child_iterator &ci,
                                                const VectorType &source_vector,
@@ -467,7 +598,7 @@ shared(source_vector, W, my_box, m_W, m_col_query, m_expansions)
           connected_buckets.push_back(cj);
         } else {
           size_t source_index = m_col_query->get_bucket_index(*cj);
-          m_expansions.M2L(g, target_box, source_box, m_W[source_index]);
+          calculate_M2L(g, target_box, source_box, m_W[source_index]);
         }
       }
     } else {
@@ -487,7 +618,7 @@ shared(source_vector, W, my_box, m_W, m_col_query, m_expansions)
               connected_buckets.push_back(cj);
             } else {
               size_t source_index = m_col_query->get_bucket_index(*cj);
-              m_expansions.M2L(g, target_box, source_box, m_W[source_index]);
+              calculate_M2L(g, target_box, source_box, m_W[source_index]);
             }
           }
         }
@@ -83,10 +83,7 @@ class H2Matrix {
       vector_of_p2p_matrices_type;
   typedef typename traits_type::template vector_type<l2l_matrix_type>::type
       l2l_matrices_type;
-  typedef typename traits_type::template vector_type<m2l_matrix_type>::type
-      m2l_matrices_type;
-  typedef typename traits_type::template vector_type<m2l_matrices_type>::type
-      vector_of_m2l_matrices_type;
+  typedef detail::M2LMatrixCache<dimension, m2l_matrix_type> m2l_cache_type;
   typedef typename traits_type::template vector_type<size_t>::type indices_type;
   typedef typename traits_type::template vector_type<indices_type>::type
       vector_of_indices_type;
@@ -105,7 +102,8 @@ class H2Matrix {
   p2m_matrices_type m_p2m_matrices;
   l2l_matrices_type m_l2l_matrices;
   vector_of_p2p_matrices_type m_p2p_matrices;
-  vector_of_m2l_matrices_type m_m2l_matrices;
+  m2l_cache_type m_m2l_matrices;
+  vector_of_indices_type m_m2l_indices;
   vector_of_indices_type m_row_indices;
   vector_of_indices_type m_col_indices;
 
@@ -114,6 +112,12 @@ class H2Matrix {
   connectivity_type m_strong_connectivity;
   connectivity_type m_weak_connectivity;
 
+  // tree nodes grouped by depth, along with the bucket index of each node's
+  // parent (-1 for the root nodes), used for level-by-level (parallel) sweeps
+  connectivity_type m_levels;
+  vector_of_indices_type m_level_parents;
+  child_iterator_vector_type m_leafs;
+
   Expansions m_expansions;
 
   const Query *m_query;
@@ -121,10 +125,18 @@ class H2Matrix {
   const size_t m_row_size;
 
 public:
+  /// if @p translation_invariant is true the kernel is assumed to depend only
+  /// on the difference between the two positions, and M2L matrices are
+  /// shared between box pairs with the same size and relative position. If
+  /// @p m2l_tolerance is positive the M2L matrices are stored in low-rank
+  /// form with this relative error (gen_extended_matrix() and related
+  /// functions then cannot be used)
   template <typename RowParticles>
   H2Matrix(const RowParticles &row_particles, const ColParticles &col_particles,
-           const Expansions &expansions)
-      : m_query(&col_particles.get_query()), m_expansions(expansions),
+           const Expansions &expansions,
+           const bool translation_invariant = false,
+           const double m2l_tolerance = 0)
+      : m_expansions(expansions), m_query(&col_particles.get_query()),
         m_col_particles(&col_particles), m_row_size(row_particles.size()) {
     // generate h2 matrix
     const size_t n = m_query->number_of_buckets();
@@ -137,7 +149,9 @@ public:
     m_W.resize(n);
     m_g.resize(n);
     m_l2l_matrices.resize(n);
-    m_m2l_matrices.resize(n);
+    m_m2l_indices.resize(n);
+    m_m2l_matrices.clear(m_query->get_bounds(), translation_invariant);
+    m_m2l_matrices.set_compression(m2l_tolerance);
     m_row_indices.resize(n);
     m_col_indices.resize(n);
     m_ext_indicies.resize(n);
@@ -159,21 +173,20 @@ public:
         m_row_indices[index].push_back(i);
       }
     }
-    for (auto &bucket : m_query->get_subtree()) {
-      if (m_query->is_leaf_node(bucket)) { // leaf node
-        const size_t index = m_query->get_bucket_index(bucket);
-        // get target_index
-        for (auto &p : m_query->get_bucket_particles(bucket)) {
-          const size_t i = &get<position>(p) - &get<position>(col_particles)[0];
-          m_col_indices[index].push_back(i);
-          if (row_equals_col) {
-            m_row_indices[index].push_back(i);
-          }
+    generate_levels();
+    for (const child_iterator &ci : m_leafs) {
+      const size_t index = m_query->get_bucket_index(*ci);
+      // get target_index
+      for (auto p = m_query->get_bucket_particles(*ci); p != false; ++p) {
+        const size_t i = &get<position>(*p) - &get<position>(col_particles)[0];
+        m_col_indices[index].push_back(i);
+        if (row_equals_col) {
+          m_row_indices[index].push_back(i);
         }
-
-        m_source_vector[index].resize(m_col_indices[index].size());
-        m_target_vector[index].resize(m_row_indices[index].size());
       }
+
+      m_source_vector[index].resize(m_col_indices[index].size());
+      m_target_vector[index].resize(m_row_indices[index].size());
     }
 
     // create a vector of column indicies for extended column matrix/vector
@@ -184,11 +197,13 @@ public:
     // downward sweep of tree to generate matrices
     LOG(2, "\tgenerating matrices...");
     for (child_iterator ci = m_query->get_children(); ci != false; ++ci) {
-      const box_type &target_box = m_query->get_bounds(ci);
       generate_matrices(child_iterator_vector_type(), box_type(), ci,
                         row_particles, col_particles);
     }
-    LOG(2, "\tdone");
+    m_m2l_matrices.generate(m_expansions);
+    LOG(2, "\tdone, using " << m_m2l_matrices.size()
+                            << " M2L matrices, average rank "
+                            << m_m2l_matrices.average_rank());
   }
 
   H2Matrix(const H2Matrix &matrix) = default;
@@ -210,11 +225,14 @@ public:
         m_l2l_matrices(matrix.m_l2l_matrices),
         // m_p2p_matrices(matrix.m_p2p_matrices), \\going to redo these
         m_m2l_matrices(matrix.m_m2l_matrices),
+        m_m2l_indices(matrix.m_m2l_indices),
         // m_row_indices(matrix.m_row_indices), \\going to redo these
         m_col_indices(matrix.m_col_indices),
         m_strong_connectivity(matrix.m_strong_connectivity),
         m_weak_connectivity(matrix.m_weak_connectivity),
-        m_query(matrix.m_query), m_expansions(matrix.m_expansions),
+        m_levels(matrix.m_levels), m_level_parents(matrix.m_level_parents),
+        m_leafs(matrix.m_leafs),
+        m_expansions(matrix.m_expansions), m_query(matrix.m_query),
         m_col_particles(matrix.m_col_particles),
         m_row_size(row_particles.size()) {
     const size_t n = m_query->number_of_buckets();
@@ -241,44 +259,64 @@ public:
     }
 
     for (child_iterator ci = m_query->get_children(); ci != false; ++ci) {
-      const box_type &target_box = m_query->get_bounds(ci);
       generate_row_matrices(ci, row_particles, *m_col_particles);
     }
   }
 
   // target_vector += A*source_vector
+  //
+  // the tree is swept level by level, with the nodes in each level processed
+  // in parallel (if HAVE_OPENMP is defined). Each node only writes to its own
+  // multipole/local coefficients and each row particle belongs to a single
+  // leaf, so the result does not depend on the number of threads
   template <typename VectorTypeTarget, typename VectorTypeSource>
   void matrix_vector_multiply(VectorTypeTarget &target_vector,
                               const VectorTypeSource &source_vector) const {
 
     // for all leaf nodes setup source vector
-    for (auto &bucket : m_query->get_subtree()) {
-      if (m_query->is_leaf_node(bucket)) { // leaf node
-        const size_t index = m_query->get_bucket_index(bucket);
-        for (size_t i = 0; i < m_col_indices[index].size(); ++i) {
-          m_source_vector[index][i] = source_vector[m_col_indices[index][i]];
-        }
+    const int n_leafs = m_leafs.size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int k = 0; k < n_leafs; ++k) {
+      const size_t index = m_query->get_bucket_index(*m_leafs[k]);
+      for (size_t i = 0; i < m_col_indices[index].size(); ++i) {
+        m_source_vector[index][i] = source_vector[m_col_indices[index][i]];
       }
     }
 
-    // upward sweep of tree
-    for (child_iterator ci = m_query->get_children(); ci != false; ++ci) {
-      mvm_upward_sweep(ci);
+    // upward sweep of tree, from the deepest level to the root
+    for (int level = static_cast<int>(m_levels.size()) - 1; level >= 0;
+         --level) {
+      const int n = m_levels[level].size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int k = 0; k < n; ++k) {
+        mvm_upward_sweep_node(m_levels[level][k]);
+      }
     }
 
-    // downward sweep of tree.
-    for (child_iterator ci = m_query->get_children(); ci != false; ++ci) {
-      m_vector_type g = m_vector_type::Zero();
-      mvm_downward_sweep(g, ci);
+    // downward sweep of tree, from the root to the deepest level
+    for (size_t level = 0; level < m_levels.size(); ++level) {
+      const int n = m_levels[level].size();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+      for (int k = 0; k < n; ++k) {
+        mvm_downward_sweep_node(m_levels[level][k],
+                                m_level_parents[level][k]);
+      }
     }
 
     // for all leaf nodes copy to target vector
-    for (auto &bucket : m_query->get_subtree()) {
-      if (m_query->is_leaf_node(bucket)) { // leaf node
-        const size_t index = m_query->get_bucket_index(bucket);
-        for (size_t i = 0; i < m_row_indices[index].size(); ++i) {
-          target_vector[m_row_indices[index][i]] += m_target_vector[index][i];
-        }
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int k = 0; k < n_leafs; ++k) {
+      const size_t index = m_query->get_bucket_index(*m_leafs[k]);
+      for (size_t i = 0; i < m_row_indices[index].size(); ++i) {
+        target_vector[m_row_indices[index][i]] += m_target_vector[index][i];
       }
     }
   }
@@ -457,7 +495,7 @@ public:
         for (int im = 0; im < vector_size; ++im) {
           for (int jm = 0; jm < vector_size; ++jm) {
             A.insert(row_index + im, col_index + jm) =
-                m_m2l_matrices[i][j](im, jm);
+                m_m2l_matrices[m_m2l_indices[i][j]](im, jm);
           }
         }
       }
@@ -802,12 +840,13 @@ public:
         const size_t col_index = size_x + index * vector_size;
         for (int im = 0; im < vector_size; ++im) {
           for (int jm = 0; jm < vector_size; ++jm) {
-            if (m_m2l_matrices[i][j](im, jm) < 1e-10) {
-              std::cout << "tooo small!!!!! " << m_m2l_matrices[i][j](im, jm)
+            if (m_m2l_matrices[m_m2l_indices[i][j]](im, jm) < 1e-10) {
+              std::cout << "tooo small!!!!! "
+                        << m_m2l_matrices[m_m2l_indices[i][j]](im, jm)
                         << std::endl;
             }
             A.insert(row_index + im, col_index + jm) =
-                m_m2l_matrices[i][j](im, jm);
+                m_m2l_matrices[m_m2l_indices[i][j]](im, jm);
           }
         }
       }
@@ -1017,11 +1056,9 @@ private:
           m_strong_connectivity[target_index].push_back(cj);
         } else {
           // from weakly connected buckets,
-          // add connectivity and generate m2l matricies
-          size_t source_index = m_query->get_bucket_index(*cj);
-          m_m2l_matrices[target_index].emplace_back();
-          m_expansions.M2L_matrix(*(m_m2l_matrices[target_index].end() - 1),
-                                  target_box, source_box);
+          // add connectivity and m2l matrix index
+          m_m2l_indices[target_index].push_back(
+              m_m2l_matrices.insert(target_box, source_box));
           m_weak_connectivity[target_index].push_back(cj);
         }
       }
@@ -1041,10 +1078,8 @@ private:
             if (theta.check(source_box.bmin, source_box.bmax)) {
               m_strong_connectivity[target_index].push_back(cj);
             } else {
-              size_t source_index = m_query->get_bucket_index(*cj);
-              m_m2l_matrices[target_index].emplace_back();
-              m_expansions.M2L_matrix(*(m_m2l_matrices[target_index].end() - 1),
-                                      target_box, source_box);
+              m_m2l_indices[target_index].push_back(
+                  m_m2l_matrices.insert(target_box, source_box));
               m_weak_connectivity[target_index].push_back(cj);
             }
           }
@@ -1075,8 +1110,8 @@ private:
                                   m_col_indices[source_index], row_particles,
                                   col_particles);
         } else {
-          auto range = m_query->get_subtree(source);
-          for (all_iterator i = range.begin(); i != range.end(); ++i) {
+          for (all_iterator i = m_query->get_subtree(source); i != false;
+               ++i) {
             if (m_query->is_leaf_node(*i)) {
               m_strong_connectivity[target_index].push_back(
                   i.get_child_iterator());
@@ -1122,10 +1157,43 @@ private:
     }
   }
 
-  m_vector_type &mvm_upward_sweep(const child_iterator &ci) const {
+  void generate_levels() {
+    m_levels.clear();
+    m_level_parents.clear();
+    m_leafs.clear();
+    child_iterator_vector_type level;
+    indices_type parents;
+    for (child_iterator ci = m_query->get_children(); ci != false; ++ci) {
+      level.push_back(ci);
+      parents.push_back(static_cast<size_t>(-1));
+    }
+    while (!level.empty()) {
+      child_iterator_vector_type next_level;
+      indices_type next_parents;
+      for (const child_iterator &ci : level) {
+        if (m_query->is_leaf_node(*ci)) {
+          m_leafs.push_back(ci);
+        } else {
+          const size_t index = m_query->get_bucket_index(*ci);
+          for (child_iterator cj = m_query->get_children(ci); cj != false;
+               ++cj) {
+            next_level.push_back(cj);
+            next_parents.push_back(index);
+          }
+        }
+      }
+      m_levels.push_back(level);
+      m_level_parents.push_back(parents);
+      level.swap(next_level);
+      parents.swap(next_parents);
+    }
+  }
+
+  // P2M for leafs, M2M for other nodes (children must already be done)
+  void mvm_upward_sweep_node(const child_iterator &ci) const {
     const size_t my_index = m_query->get_bucket_index(*ci);
-    const box_type &target_box = m_query->get_bounds(ci);
-    LOG(3, "calculate_dive_P2M_and_M2M with bucket " << target_box);
+    LOG(3, "calculate_dive_P2M_and_M2M with bucket "
+               << m_query->get_bounds(ci));
     m_vector_type &W = m_W[my_index];
     if (m_query->is_leaf_node(*ci)) { // leaf node
       W = m_p2m_matrices[my_index] * m_source_vector[my_index];
@@ -1134,35 +1202,36 @@ private:
       W = m_vector_type::Zero();
       for (child_iterator cj = m_query->get_children(ci); cj != false; ++cj) {
         const size_t child_index = m_query->get_bucket_index(*cj);
-        m_vector_type &child_W = mvm_upward_sweep(cj);
-        W += m_l2l_matrices[child_index].transpose() * child_W;
+        W += m_l2l_matrices[child_index].transpose() * m_W[child_index];
       }
     }
-    return W;
   }
 
-  void mvm_downward_sweep(const m_vector_type &g_parent,
-                          const child_iterator &ci) const {
-    const box_type &target_box = m_query->get_bounds(ci);
-    LOG(3, "calculate_dive_M2L_and_L2L with bucket " << target_box);
+  // L2L and M2L for all nodes, L2P and P2P for leafs (parent must already be
+  // done)
+  void mvm_downward_sweep_node(const child_iterator &ci,
+                               const size_t parent_index) const {
+    LOG(3, "calculate_dive_M2L_and_L2L with bucket "
+               << m_query->get_bounds(ci));
     size_t target_index = m_query->get_bucket_index(*ci);
     m_vector_type &g = m_g[target_index];
 
     // L2L
-    g = m_l2l_matrices[target_index] * g_parent;
+    if (parent_index == static_cast<size_t>(-1)) {
+      g = m_vector_type::Zero();
+    } else {
+      g = m_l2l_matrices[target_index] * m_g[parent_index];
+    }
 
     // M2L (weakly connected buckets)
     for (size_t i = 0; i < m_weak_connectivity[target_index].size(); ++i) {
       const child_iterator &source_ci = m_weak_connectivity[target_index][i];
       size_t source_index = m_query->get_bucket_index(*source_ci);
-      g += m_m2l_matrices[target_index][i] * m_W[source_index];
+      m_m2l_matrices.apply(m_m2l_indices[target_index][i], g,
+                           m_W[source_index]);
     }
 
-    if (!m_query->is_leaf_node(*ci)) { // dive down to next level
-      for (child_iterator cj = m_query->get_children(ci); cj != false; ++cj) {
-        mvm_downward_sweep(g, cj);
-      }
-    } else {
+    if (m_query->is_leaf_node(*ci)) {
       m_target_vector[target_index] = m_l2p_matrices[target_index] * g;
 
       // direct evaluation (strongly connected buckets)
@@ -43,7 +43,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Traits.h"
 #include "Vector.h"
 #include <boost/iterator/iterator_facade.hpp>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <set>
 #include <vector>
 
@@ -72,7 +74,10 @@ class Kdtree : public neighbour_search_base<Kdtree<Traits>, Traits,
   friend base_type;
 
 public:
-  Kdtree() : base_type(), m_number_of_levels(0) {
+  Kdtree()
+      : base_type(), m_number_of_levels(0), m_build_num_points(0),
+        m_build_leaf_extent(0), m_order_changed(true), m_number_of_refits(0),
+        m_number_of_rebuilds(0) {
 
     this->m_query.m_nodes_child =
         iterator_to_raw_pointer(m_nodes_child.begin());
@@ -80,6 +85,8 @@ public:
         iterator_to_raw_pointer(m_nodes_split_dim.begin());
     this->m_query.m_nodes_split_pos =
         iterator_to_raw_pointer(m_nodes_split_pos.begin());
+    this->m_query.m_nodes_bmin = iterator_to_raw_pointer(m_nodes_bmin.begin());
+    this->m_query.m_nodes_bmax = iterator_to_raw_pointer(m_nodes_bmax.begin());
     this->m_query.m_number_of_buckets = m_nodes_child.size();
     this->m_query.m_number_of_levels = m_number_of_levels;
   }
@@ -90,11 +97,24 @@ public:
 
   void print_data_structure() const { print_tree(); }
 
+  ///
+  /// @brief the number of updates that refitted the existing tree
+  ///
+  size_t get_number_of_refits() const { return m_number_of_refits; }
+
+  ///
+  /// @brief the number of updates that (re)built the tree from scratch
+  ///
+  size_t get_number_of_rebuilds() const { return m_number_of_rebuilds; }
+
 private:
   void set_domain_impl() {
     this->m_query.m_bounds.bmin = this->m_bounds.bmin;
     this->m_query.m_bounds.bmax = this->m_bounds.bmax;
     this->m_query.m_periodic = this->m_periodic;
+
+    // the domain has changed, so the next update must rebuild the tree
+    m_build_num_points = 0;
   }
 
   void update_iterator_impl() {}
@@ -137,6 +157,23 @@ private:
            "error should be update all");
 
     const size_t num_points = this->m_alive_indices.size();
+    m_order_changed = true;
+
+    // if there are no new or dead particles then the particles are still in
+    // the order of the leafs of the current tree (and m_alive_indices is the
+    // sequence 0..n-1), so try to refit the tree rather than rebuild it
+    if (detail::is_std_iterator<typename vector_int::iterator>::type::value &&
+        num_points > 0 && num_points == m_build_num_points &&
+        static_cast<size_t>(update_end - update_begin) == num_points) {
+      if (refit_tree()) {
+        LOG(2, "Kdtree: refitted tree");
+        ++m_number_of_refits;
+        m_order_changed = false;
+        return;
+      }
+      LOG(2, "Kdtree: refit failed, rebuilding tree");
+    }
+    ++m_number_of_rebuilds;
 
     // setup particles
     LOG(3, "update_positions_impl(kdtree): setup particles");
@@ -148,12 +185,17 @@ private:
       detail::copy(this->m_alive_indices.begin(), this->m_alive_indices.end(),
                    m_particle_indicies.begin() + i * num_points);
 
-      // sort indicies by position in dimension i
+      // sort indicies by position in dimension i. Ties are broken by index
+      // so that the tree does not depend on the number of threads used to
+      // sort
       detail::sort(
           m_particle_indicies.begin() + i * num_points,
           m_particle_indicies.begin() + (i + 1) * num_points,
           [_p = iterator_to_raw_pointer(get<position>(this->m_particles_begin)),
-           _i = i](const int a, const int b) { return _p[a][_i] < _p[b][_i]; });
+           _i = i](const int a, const int b) {
+            return _p[a][_i] < _p[b][_i] ||
+                   (_p[a][_i] == _p[b][_i] && a < b);
+          });
     }
     /*
     for (size_t i = 0; i < dimension; ++i) {
@@ -184,10 +226,130 @@ private:
         iterator_to_raw_pointer(m_nodes_split_dim.begin());
     this->m_query.m_nodes_split_pos =
         iterator_to_raw_pointer(m_nodes_split_pos.begin());
+    this->m_query.m_nodes_bmin = iterator_to_raw_pointer(m_nodes_bmin.begin());
+    this->m_query.m_nodes_bmax = iterator_to_raw_pointer(m_nodes_bmax.begin());
     this->m_query.m_number_of_buckets = m_nodes_child.size();
     this->m_query.m_number_of_levels = m_number_of_levels;
+
+    if (detail::is_std_iterator<typename vector_int::iterator>::type::value &&
+        num_points > 0) {
+      m_build_num_points = num_points;
+      m_build_leaf_extent = calculate_leaf_extent();
+    } else {
+      m_build_num_points = 0;
+    }
   }
 
+  ///
+  /// @brief returns the sum over all the leafs of the side lengths of the
+  /// bounding box of the particles in each leaf. This is used as a measure of
+  /// the quality of the tree. Must be called after build_tree(), before the
+  /// particles are reordered
+  ///
+  double calculate_leaf_extent() {
+    const int num_nodes = m_nodes_child.size();
+    const int *alive_indices =
+        iterator_to_raw_pointer(this->m_alive_indices.begin());
+    const double_d *p =
+        iterator_to_raw_pointer(get<position>(this->m_particles_begin));
+    double extent = 0;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for reduction(+ : extent)
+#endif
+    for (int i = 0; i < num_nodes; ++i) {
+      const int first = -m_nodes_child[i] - 1;
+      const int last = -m_nodes_split_dim[i] - 1;
+      if (m_nodes_child[i] < 0 && last > first) {
+        double_d minb = p[alive_indices[first]];
+        double_d maxb = minb;
+        for (int j = first + 1; j < last; ++j) {
+          const double_d &pj = p[alive_indices[j]];
+          for (size_t d = 0; d < dimension; ++d) {
+            minb[d] = std::min(minb[d], pj[d]);
+            maxb[d] = std::max(maxb[d], pj[d]);
+          }
+        }
+        extent += (maxb - minb).sum();
+      }
+    }
+    return extent;
+  }
+
+  ///
+  /// @brief updates the bounds of the nodes to match the current particle
+  /// positions, keeping the topology of the tree, the splits and the
+  /// particles in each leaf the same
+  ///
+  /// The bounds of each leaf are the union of the cell it was given by the
+  /// splits when the tree was built and the bounding box of its particles, so
+  /// that the leafs still cover the domain, but the children of a node may
+  /// overlap once particles have moved across its split. The bounds of the
+  /// nodes are then calculated bottom-up. The refit fails, and the tree is
+  /// rebuilt instead, if the leaf extent (see calculate_leaf_extent()) has
+  /// grown by more than a factor #max_refit_leaf_extent_ratio since the tree
+  /// was built
+  ///
+  /// @return true if the tree was refitted, false if it needs to be rebuilt
+  ///
+  bool refit_tree() {
+    const int num_nodes = m_nodes_child.size();
+    const double_d *p =
+        iterator_to_raw_pointer(get<position>(this->m_particles_begin));
+    const double inf = std::numeric_limits<double>::infinity();
+
+    // bounds of the particles in each leaf
+    double extent = 0;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for reduction(+ : extent)
+#endif
+    for (int i = 0; i < num_nodes; ++i) {
+      if (m_nodes_child[i] < 0) {
+        double_d minb = double_d::Constant(inf);
+        double_d maxb = double_d::Constant(-inf);
+        const int first = -m_nodes_child[i] - 1;
+        const int last = -m_nodes_split_dim[i] - 1;
+        for (int j = first; j < last; ++j) {
+          for (size_t d = 0; d < dimension; ++d) {
+            minb[d] = std::min(minb[d], p[j][d]);
+            maxb[d] = std::max(maxb[d], p[j][d]);
+          }
+        }
+        if (last > first) {
+          extent += (maxb - minb).sum();
+        }
+        for (size_t d = 0; d < dimension; ++d) {
+          m_nodes_bmin[i][d] = std::min(m_nodes_cell_bmin[i][d], minb[d]);
+          m_nodes_bmax[i][d] = std::max(m_nodes_cell_bmax[i][d], maxb[d]);
+        }
+      }
+    }
+
+    LOG(3, "Kdtree: leaf extent = " << extent << " (was "
+                                    << m_build_leaf_extent << " at build)");
+    if (extent > max_refit_leaf_extent_ratio * m_build_leaf_extent) {
+      // the node bounds are reset by the rebuild
+      return false;
+    }
+
+    // children are always stored after their parent, so can go bottom-up
+    // through the nodes in reverse order
+    for (int i = num_nodes - 1; i >= 0; --i) {
+      const int child = m_nodes_child[i];
+      if (child < 0) {
+        continue;
+      }
+      for (size_t d = 0; d < dimension; ++d) {
+        m_nodes_bmin[i][d] =
+            std::min(m_nodes_bmin[child][d], m_nodes_bmin[child + 1][d]);
+        m_nodes_bmax[i][d] =
+            std::max(m_nodes_bmax[child][d], m_nodes_bmax[child + 1][d]);
+      }
+    }
+    return true;
+  }
+
+  bool order_changed_impl() const { return m_order_changed; }
+
   const KdtreeQuery<Traits> &get_query_impl() const { return m_query; }
 
   KdtreeQuery<Traits> &get_query_impl() { return m_query; }
@@ -214,6 +376,10 @@ private:
     m_nodes_split_pos.resize(1);
     m_nodes_split_dim.resize(1);
     m_nodes_child[0] = 1;
+    m_nodes_cell_bmin.resize(1);
+    m_nodes_cell_bmax.resize(1);
+    m_nodes_cell_bmin[0] = this->m_bounds.bmin;
+    m_nodes_cell_bmax[0] = this->m_bounds.bmax;
     m_number_of_levels = 1;
     int prev_level_index = 0;
     // m_nodes_child  int-> index of first child node (<0 is a leaf, gives index
@@ -524,6 +690,12 @@ private:
       m_nodes_child.resize(children_end);
       m_nodes_split_pos.resize(children_end);
       m_nodes_split_dim.resize(children_end);
+      m_nodes_cell_bmin.resize(children_end);
+      m_nodes_cell_bmax.resize(children_end);
+      detail::copy(children_bmin.begin(), children_bmin.end(),
+                   m_nodes_cell_bmin.begin() + prev_level_index);
+      detail::copy(children_bmax.begin(), children_bmax.end(),
+                   m_nodes_cell_bmax.begin() + prev_level_index);
       auto tree_it = Traits::make_zip_iterator(
           Traits::make_tuple(m_nodes_child.begin(), m_nodes_split_dim.begin()));
       detail::tabulate(
@@ -554,6 +726,14 @@ private:
       detail::copy_if(child_it, child_it + num_children, children_type.begin(),
                       parents_it);
     }
+
+    // until the tree is refitted, the bounds of each node are its cell
+    m_nodes_bmin.resize(m_nodes_cell_bmin.size());
+    m_nodes_bmax.resize(m_nodes_cell_bmax.size());
+    detail::copy(m_nodes_cell_bmin.begin(), m_nodes_cell_bmin.end(),
+                 m_nodes_bmin.begin());
+    detail::copy(m_nodes_cell_bmax.begin(), m_nodes_cell_bmax.end(),
+                 m_nodes_bmax.begin());
 #ifndef __CUDA_ARCH__
     if (3 <= ABORIA_LOG_LEVEL) {
       print_tree();
@@ -565,10 +745,33 @@ private:
   vector_int m_nodes_split_dim;
   vector_double m_nodes_split_pos;
 
+  // bounds of each node, used by the queries, and the cell each node was
+  // given by the splits when the tree was built. These are the same until
+  // the tree is refitted
+  vector_double_d m_nodes_bmin;
+  vector_double_d m_nodes_bmax;
+  vector_double_d m_nodes_cell_bmin;
+  vector_double_d m_nodes_cell_bmax;
+
   vector_int m_particle_indicies;
   vector_int m_particle_node;
   int m_number_of_levels;
   KdtreeQuery<Traits> m_query;
+
+  ///
+  /// @brief the tree is rebuilt rather than refitted if the leaf extent grows
+  /// by more than this factor since the tree was built
+  ///
+  static constexpr double max_refit_leaf_extent_ratio = 1.5;
+
+  // number of particles and leaf extent when the tree was last built
+  size_t m_build_num_points;
+  double m_build_leaf_extent;
+  bool m_order_changed;
+
+  // number of updates that took the refit and rebuild paths
+  size_t m_number_of_refits;
+  size_t m_number_of_rebuilds;
 }; // namespace Aboria
 
 template <typename Query> class KdtreeChildIterator {
@@ -675,9 +878,12 @@ template <typename Traits> struct KdtreeQuery {
   int *m_nodes_child;
   int *m_nodes_split_dim;
   double *m_nodes_split_pos;
+  double_d *m_nodes_bmin;
+  double_d *m_nodes_bmax;
 
   size_t *m_id_map_key;
   size_t *m_id_map_value;
+  size_t m_id_map_dense_size;
 
   const box_type &get_bounds() const { return m_bounds; }
   const bool_d &get_periodic() const { return m_periodic; }
@@ -696,14 +902,10 @@ public:
   ABORIA_HOST_DEVICE_IGNORE_WARN
   CUDA_HOST_DEVICE
   raw_pointer find(const size_t id) const {
-    const size_t n = number_of_particles();
-    size_t *last = m_id_map_key + n;
-    size_t *first = detail::lower_bound(m_id_map_key, last, id);
-    if ((first != last) && !(id < *first)) {
-      return m_particles_begin + m_id_map_value[first - m_id_map_key];
-    } else {
-      return m_particles_begin + n;
-    }
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
   }
 
   /*
@@ -745,15 +947,8 @@ public:
   }
 
   const box_type get_bounds(const child_iterator &ci) const {
-    box_type ret = (*ci).bounds;
-    const int pindex = get_parent_index(*ci);
-    const int i = m_nodes_split_dim[pindex];
-    if (ci.is_high()) {
-      ret.bmin[i] = m_nodes_split_pos[pindex];
-    } else {
-      ret.bmax[i] = m_nodes_split_pos[pindex];
-    }
-    return ret;
+    const int cindex = get_child_index(*ci);
+    return box_type(m_nodes_bmin[cindex], m_nodes_bmax[cindex]);
   }
 
   particle_iterator get_bucket_particles(reference bucket) const {
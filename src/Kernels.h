@@ -573,6 +573,12 @@ public:
   void evaluate(VectorLHS &lhs, const VectorRHS &rhs) const {
     m_fmm.matrix_vector_multiply(lhs, rhs);
   }
+
+  /// @copydoc FastMultipoleMethod::set_m2l_compression()
+  void set_m2l_compression(const double tolerance,
+                           const bool translation_invariant = false) {
+    m_fmm.set_m2l_compression(tolerance, translation_invariant);
+  }
 };
 
 template <typename RowElements, typename ColElements, typename FRadius,
@@ -591,9 +597,30 @@ protected:
                     detail::is_particles<ColElements>::value,
                 "only implemented for particle elements");
 
+  typedef typename std::decay<typename std::result_of<FWithDx(
+      const_position_reference, const_row_reference,
+      const_col_reference)>::type>::type FunctionReturn;
+  typedef std::vector<FunctionReturn, Eigen::aligned_allocator<FunctionReturn>>
+      cache_values_type;
+
   FRadius m_radius_function;
   FWithDx m_dx_function;
 
+  bool m_cache_sparsity;
+  bool m_cache_values;
+
+  // cached CSR sparsity pattern (and optionally values), valid for the given
+  // update counts and sizes of the row and column particle sets
+  mutable bool m_cache_valid;
+  mutable size_t m_cache_row_update_count;
+  mutable size_t m_cache_col_update_count;
+  mutable size_t m_cache_row_size;
+  mutable size_t m_cache_col_size;
+  mutable std::vector<size_t> m_cache_offsets;
+  mutable std::vector<size_t> m_cache_indices;
+  mutable std::vector<double_d> m_cache_dx;
+  mutable cache_values_type m_cache_function_values;
+
 public:
   typedef typename base_type::Block Block;
   typedef typename base_type::Scalar Scalar;
@@ -604,7 +631,42 @@ public:
                const FRadius &radius_function, const FWithDx &withdx_function)
       : base_type(row_elements, col_elements,
                   F(col_elements, radius_function, withdx_function)),
-        m_radius_function(radius_function), m_dx_function(withdx_function){};
+        m_radius_function(radius_function), m_dx_function(withdx_function),
+        m_cache_sparsity(false), m_cache_values(false), m_cache_valid(false),
+        m_cache_row_update_count(0), m_cache_col_update_count(0),
+        m_cache_row_size(0), m_cache_col_size(0){};
+
+  /// Enables or disables caching of the sparsity pattern. If enabled, the
+  /// first call to evaluate() records the column index and separation of
+  /// every non-zero in a compressed sparse row (CSR) structure, and later
+  /// calls replay this rather than performing a neighbour search for every
+  /// row. The cache is rebuilt automatically if update_positions() has been
+  /// called on, or particles added to or removed from, either particle set.
+  /// Note that this includes the row particles, whose positions are the
+  /// search centres: if these are moved then update_positions() (or
+  /// clear_cache()) must be called on them before the next evaluate()
+  void set_cache_sparsity(const bool cache) {
+    m_cache_sparsity = cache;
+    if (!cache) {
+      m_cache_values = false;
+    }
+    clear_cache();
+  }
+
+  /// Enables or disables caching of the kernel values (this implies
+  /// set_cache_sparsity()), so that evaluate() becomes a sparse
+  /// matrix-vector multiply. Note that clear_cache() must be called if any
+  /// particle variables used by the kernel function are altered
+  void set_cache_values(const bool cache) {
+    m_cache_values = cache;
+    if (cache) {
+      m_cache_sparsity = true;
+    }
+    clear_cache();
+  }
+
+  /// Discards any cached sparsity pattern or kernel values
+  void clear_cache() const { m_cache_valid = false; }
 
   /*
    * shouldn't need this anymore....
@@ -639,16 +701,15 @@ public:
     for (size_t i = 0; i < na; ++i) {
       const_row_reference ai = a[i];
       const double radius = m_radius_function(ai);
-      for (auto pairj =
-               euclidean_search(b.get_query(), get<position>(ai), radius);
-           pairj != false; ++pairj) {
-        const_col_reference bj = *pairj;
-        const_position_reference dx = pairj.dx();
-        const size_t j = &get<position>(bj) - get<position>(b).data();
-        const_cast<MatrixType &>(matrix).template block<BlockRows, BlockCols>(
-            i * BlockRows, j * BlockCols) =
-            static_cast<Block>(m_dx_function(dx, ai, bj));
-      }
+      for_each_neighbour(
+          b.get_query(), get<position>(ai), radius,
+          [&](const_col_reference bj, const_position_reference dx) {
+            const size_t j = &get<position>(bj) - get<position>(b).data();
+            const_cast<MatrixType &>(matrix)
+                .template block<BlockRows, BlockCols>(i * BlockRows,
+                                                      j * BlockCols) =
+                static_cast<Block>(m_dx_function(dx, ai, bj));
+          });
     }
   }
 
@@ -666,21 +727,20 @@ public:
     for (size_t i = 0; i < na; ++i) {
       const_row_reference ai = a[i];
       const double radius = m_radius_function(ai);
-      for (auto pairj =
-               euclidean_search(b.get_query(), get<position>(ai), radius);
-           pairj != false; ++pairj) {
-        const_col_reference bj = *pairj;
-        const_position_reference dx = pairj.dx();
-        const size_t j = &get<position>(bj) - get<position>(b).data();
-        const Block element = static_cast<Block>(m_dx_function(dx, ai, bj));
-        for (size_t ii = 0; ii < BlockRows; ++ii) {
-          for (size_t jj = 0; jj < BlockCols; ++jj) {
-            triplets.push_back(Triplet(i * BlockRows + ii + startI,
-                                       j * BlockCols + jj + startJ,
-                                       element(ii, jj)));
-          }
-        }
-      }
+      for_each_neighbour(
+          b.get_query(), get<position>(ai), radius,
+          [&](const_col_reference bj, const_position_reference dx) {
+            const size_t j = &get<position>(bj) - get<position>(b).data();
+            const Block element =
+                static_cast<Block>(m_dx_function(dx, ai, bj));
+            for (size_t ii = 0; ii < BlockRows; ++ii) {
+              for (size_t jj = 0; jj < BlockCols; ++jj) {
+                triplets.push_back(Triplet(i * BlockRows + ii + startI,
+                                           j * BlockCols + jj + startJ,
+                                           element(ii, jj)));
+              }
+            }
+          });
     }
   }
 
@@ -700,20 +760,36 @@ public:
     ASSERT(na == rhs.size(), "lhs vector has incompatible size");
     ASSERT(b.size() == lhs.size(), "rhs vector has incompatible size");
 
+    if (m_cache_sparsity) {
+      update_cache();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+      for (size_t i = 0; i < na; ++i) {
+        for (size_t k = m_cache_offsets[i]; k < m_cache_offsets[i + 1]; ++k) {
+          const size_t j = m_cache_indices[k];
+          if (m_cache_values) {
+            lhs[i] += m_cache_function_values[k] * rhs[j];
+          } else {
+            lhs[i] += m_dx_function(m_cache_dx[k], a[i], b[j]) * rhs[j];
+          }
+        }
+      }
+      return;
+    }
+
 #ifdef HAVE_OPENMP
 #pragma omp parallel for
 #endif
     for (size_t i = 0; i < na; ++i) {
       const_row_reference ai = a[i];
       const double radius = m_radius_function(ai);
-      for (auto pairj =
-               euclidean_search(b.get_query(), get<position>(ai), radius);
-           pairj != false; ++pairj) {
-        const_position_reference dx = pairj.dx();
-        const_col_reference bj = *pairj;
-        const size_t j = &get<position>(bj) - get<position>(b).data();
-        lhs[i] += m_dx_function(dx, ai, bj) * rhs[j];
-      }
+      for_each_neighbour(
+          b.get_query(), get<position>(ai), radius,
+          [&](const_col_reference bj, const_position_reference dx) {
+            const size_t j = &get<position>(bj) - get<position>(b).data();
+            lhs[i] += m_dx_function(dx, ai, bj) * rhs[j];
+          });
     }
   }
 
@@ -731,23 +807,115 @@ public:
 
     const size_t na = a.size();
 
+    if (m_cache_sparsity) {
+      update_cache();
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+      for (size_t i = 0; i < na; ++i) {
+        for (size_t k = m_cache_offsets[i]; k < m_cache_offsets[i + 1]; ++k) {
+          const size_t j = m_cache_indices[k];
+          if (m_cache_values) {
+            lhs.template segment<BlockRows>(i * BlockRows) +=
+                m_cache_function_values[k] *
+                rhs.template segment<BlockCols>(j * BlockCols);
+          } else {
+            lhs.template segment<BlockRows>(i * BlockRows) +=
+                m_dx_function(m_cache_dx[k], a[i], b[j]) *
+                rhs.template segment<BlockCols>(j * BlockCols);
+          }
+        }
+      }
+      return;
+    }
+
 #ifdef HAVE_OPENMP
 #pragma omp parallel for
 #endif
     for (size_t i = 0; i < na; ++i) {
       const_row_reference ai = a[i];
       const double radius = m_radius_function(ai);
-      for (auto pairj =
-               euclidean_search(b.get_query(), get<position>(ai), radius);
-           pairj != false; ++pairj) {
-        const_position_reference dx = pairj.dx();
-        const_col_reference bj = *pairj;
-        const size_t j = &get<position>(bj) - get<position>(b).data();
-        lhs.template segment<BlockRows>(i * BlockRows) +=
-            m_dx_function(dx, ai, bj) *
-            rhs.template segment<BlockCols>(j * BlockCols);
-      }
+      for_each_neighbour(
+          b.get_query(), get<position>(ai), radius,
+          [&](const_col_reference bj, const_position_reference dx) {
+            const size_t j = &get<position>(bj) - get<position>(b).data();
+            lhs.template segment<BlockRows>(i * BlockRows) +=
+                m_dx_function(dx, ai, bj) *
+                rhs.template segment<BlockCols>(j * BlockCols);
+          });
+    }
+  }
+
+private:
+  /// (Re)builds the cached CSR structure if it is out of date. The
+  /// structure is built in two passes, the first counts the non-zeros in
+  /// each row and the second (after a scan to obtain the row offsets) fills
+  /// in the column indices, separations and (optionally) kernel values
+  void update_cache() const {
+    const RowElements &a = this->m_row_elements;
+    const ColElements &b = this->m_col_elements;
+
+    if (m_cache_valid && m_cache_row_update_count == a.get_update_count() &&
+        m_cache_col_update_count == b.get_update_count() &&
+        m_cache_row_size == a.size() && m_cache_col_size == b.size()) {
+      return;
+    }
+
+    const size_t na = a.size();
+    LOG(2, "KernelSparse: building sparsity pattern cache for " << na
+                                                                << " rows");
+    m_cache_offsets.resize(na + 1);
+    m_cache_offsets[0] = 0;
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < na; ++i) {
+      const_row_reference ai = a[i];
+      const double radius = m_radius_function(ai);
+      size_t count = 0;
+      for_each_neighbour(
+          b.get_query(), get<position>(ai), radius,
+          [&](const_col_reference, const_position_reference) { ++count; });
+      m_cache_offsets[i + 1] = count;
     }
+
+    for (size_t i = 0; i < na; ++i) {
+      m_cache_offsets[i + 1] += m_cache_offsets[i];
+    }
+    const size_t nnz = m_cache_offsets[na];
+    m_cache_indices.resize(nnz);
+    m_cache_dx.resize(nnz);
+    if (m_cache_values) {
+      m_cache_function_values.resize(nnz);
+    } else {
+      m_cache_function_values.clear();
+    }
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < na; ++i) {
+      const_row_reference ai = a[i];
+      const double radius = m_radius_function(ai);
+      size_t k = m_cache_offsets[i];
+      for_each_neighbour(
+          b.get_query(), get<position>(ai), radius,
+          [&](const_col_reference bj, const_position_reference dx) {
+            m_cache_indices[k] = &get<position>(bj) - get<position>(b).data();
+            m_cache_dx[k] = dx;
+            if (m_cache_values) {
+              m_cache_function_values[k] = m_dx_function(dx, ai, bj);
+            }
+            ++k;
+          });
+    }
+
+    m_cache_row_update_count = a.get_update_count();
+    m_cache_col_update_count = b.get_update_count();
+    m_cache_row_size = na;
+    m_cache_col_size = b.size();
+    m_cache_valid = true;
   }
 };
 
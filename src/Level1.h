@@ -42,6 +42,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // Level1
 #include "CellList.h"
+#include "CellListAdaptive.h"
 #include "CellListOrdered.h"
 #include "CudaInclude.h"
 #include "Elements.h"
@@ -51,6 +52,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "OctTree.h"
 #include "Particles.h"
 #include "PrintTuple.h"
+#include "SpatialHash.h"
 #include "Traits.h"
 #include "Utils.h"
 #include "Variable.h"
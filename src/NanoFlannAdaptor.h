@@ -412,6 +412,7 @@ template <typename Traits> struct KdtreeNanoflannQuery {
 
   size_t *m_id_map_key;
   size_t *m_id_map_value;
+  size_t m_id_map_dense_size;
 
   const box_type &get_bounds() const { return m_bounds; }
   const bool_d &get_periodic() const { return m_periodic; }
@@ -422,14 +423,10 @@ template <typename Traits> struct KdtreeNanoflannQuery {
   ABORIA_HOST_DEVICE_IGNORE_WARN
   CUDA_HOST_DEVICE
   raw_pointer find(const size_t id) const {
-    const size_t n = number_of_particles();
-    size_t *last = m_id_map_key + n;
-    size_t *first = detail::lower_bound(m_id_map_key, last, id);
-    if ((first != last) && !(id < *first)) {
-      return m_particles_begin + m_id_map_value[first - m_id_map_key];
-    } else {
-      return m_particles_begin + n;
-    }
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
   }
 
   /*
@@ -120,6 +120,46 @@ make_iterator_range(IteratorType &&begin, IteratorType &&end) {
   return iterator_range<IteratorType>(begin, end);
 }
 
+namespace detail {
+
+///
+/// @brief the value stored in a dense find-by-id map for ids that are not in
+/// the particle set
+///
+inline CUDA_HOST_DEVICE constexpr size_t get_empty_id_map_value() {
+  return static_cast<size_t>(-1);
+}
+
+///
+/// @brief looks up the particle index of @p id in a find-by-id map
+///
+/// If @p dense_size is non-zero then @p value is an array of indices indexed by
+/// id, and @p key is not used. Otherwise @p key holds the ids of all @p n
+/// particles in sorted order, and @p value the corresponding indices
+///
+/// @return the index of the particle, or @p n if not found
+///
+ABORIA_HOST_DEVICE_IGNORE_WARN
+inline CUDA_HOST_DEVICE size_t find_in_id_map(const size_t *key,
+                                              const size_t *value,
+                                              const size_t dense_size,
+                                              const size_t n, const size_t id) {
+  if (dense_size > 0) {
+    if (id < dense_size && value[id] != get_empty_id_map_value()) {
+      return value[id];
+    }
+    return n;
+  }
+  const size_t *last = key + n;
+  const size_t *first = detail::lower_bound(key, last, id);
+  if ((first != last) && !(id < *first)) {
+    return value[first - key];
+  }
+  return n;
+}
+
+} // namespace detail
+
 ///
 /// @brief A base class for the spatial data structure classes.
 ///
@@ -157,7 +197,7 @@ public:
   /// possible using the `double` type. All periodicity is turned off, and the
   /// number of particle per bucket is set to 10
   ///
-  neighbour_search_base() : m_id_map(false) {
+  neighbour_search_base() : m_id_map(false), m_id_map_dense_size(0) {
     LOG_CUDA(2, "neighbour_search_base: constructor, setting default domain");
     const double min = std::numeric_limits<double>::min();
     const double max = std::numeric_limits<double>::max();
@@ -174,6 +214,23 @@ public:
   ///
   static constexpr bool ordered() { return true; }
 
+  ///
+  /// @brief Returns true if this spatial data structure adapts to the extent
+  ///        of the particles, and so does not need the domain bounds given to
+  ///        set_domain(). This is overloaded by the Derived class
+  ///
+  /// @return false
+  ///
+  static constexpr bool unbounded() { return false; }
+
+  ///
+  /// @brief Returns true if the last update of the spatial data structure
+  ///        changed the order of the particles (i.e. the particles need to be
+  ///        reordered to match #m_alive_indices). This can be overloaded by
+  ///        a Derived class that can detect when the order is unchanged
+  ///
+  bool order_changed_impl() const { return cast().ordered(); }
+
   ///
   /// @brief A function object used to enforce the domain extents on the set
   ///        of particles
@@ -274,15 +331,20 @@ public:
   ///
   size_t find_id_map(const size_t id) const {
     const size_t n = m_particles_end - m_particles_begin;
-    return detail::lower_bound(m_id_map_key.begin(), m_id_map_key.begin() + n,
-                               id) -
-           m_id_map_key.begin();
+    return detail::find_in_id_map(
+        iterator_to_raw_pointer(m_id_map_key.begin()),
+        iterator_to_raw_pointer(m_id_map_value.begin()), m_id_map_dense_size,
+        n, id);
   }
 
   ///
   /// @brief This function initialises the find-by-id functionality
   ///
-  /// Find-by-id works using a key and value vector pair that act as a map
+  /// Particle ids are normally allocated sequentially, so while they remain
+  /// compact (the largest id is less than #dense_id_map_factor times the
+  /// number of particles) find-by-id uses a dense array indexed by id, which
+  /// is rebuilt with a single scatter and searched in constant time.
+  /// Otherwise it falls back to a key and value vector pair that act as a map
   /// between ids and particle indicies. This pair is sorted by id for
   /// quick(ish) searching, especially in parallel. It is not as good as
   /// `std::map` on a (single-core) CPU, but can be done on a GPU using
@@ -294,6 +356,7 @@ public:
     m_id_map = true;
     m_id_map_key.clear();
     m_id_map_value.clear();
+    m_id_map_dense_size = 0;
   }
 
   ///
@@ -313,6 +376,13 @@ public:
     std::cout << std::endl;
 
     std::cout << "id map (id,index):\n";
+    if (m_id_map_dense_size > 0) {
+      for (size_t i = 0; i < m_id_map_dense_size; ++i) {
+        if (m_id_map_value[i] != detail::get_empty_id_map_value()) {
+          std::cout << "(" << i << "," << m_id_map_value[i] << ")\n";
+        }
+      }
+    }
     for (size_t i = 0; i < m_id_map_key.size(); ++i) {
       std::cout << "(" << m_id_map_key[i] << "," << m_id_map_value[i] << ")\n";
     }
@@ -441,41 +511,76 @@ public:
       // if no new particles, no dead, no reorder, or no init than can assume
       // that previous id map is correct
       if (cast().ordered() || new_n > 0 || num_dead > 0 ||
-          m_id_map_key.size() == 0) {
-        m_id_map_key.resize(dead_and_alive_n - num_dead);
-        m_id_map_value.resize(dead_and_alive_n - num_dead);
-
-        // before update range
-        if (update_start_index > 0) {
-          detail::sequence(m_id_map_value.begin(),
-                           m_id_map_value.begin() + update_start_index);
-          detail::copy(get<id>(begin), get<id>(begin) + update_start_index,
-                       m_id_map_key.begin());
-        }
-
+          m_id_map_value.size() == 0) {
         // after update range
         ASSERT(update_end_index == dead_and_alive_n,
                "if not updateing last particle then should not get here");
 
-        // update range
-        /*
-        detail::transform(m_alive_indices.begin(),m_alive_indices.end(),
-                     m_id_map_value.begin()+update_start_index,
-                     [&](const int index) {
-                        const int index_into_update = index -
-        update_start_index; const int num_dead_before_index = index_into_update
-        - m_alive_sum[index_into_update]; return index - num_dead_before_index;
-                     });
-                     */
-        detail::sequence(m_id_map_value.begin() + update_start_index,
-                         m_id_map_value.end(), update_start_index);
-        auto raw_id = iterator_to_raw_pointer(get<id>(begin));
-        detail::transform(
-            m_alive_indices.begin(), m_alive_indices.end(),
-            m_id_map_key.begin() + update_start_index,
-            [=] CUDA_HOST_DEVICE(const int index) { return raw_id[index]; });
-        detail::sort_by_key(m_id_map_key.begin(), m_id_map_key.end(),
-                            m_id_map_value.begin());
+        const size_t n_alive = dead_and_alive_n - num_dead;
+        const size_t max_id =
+            dead_and_alive_n > 0
+                ? detail::reduce(get<id>(begin), get<id>(end), size_t(0),
+                                 [] CUDA_HOST_DEVICE(const size_t a,
+                                                     const size_t b) {
+                                   return a > b ? a : b;
+                                 })
+                : 0;
+        if (n_alive > 0 && max_id < dense_id_map_factor * n_alive) {
+          // ids are compact, so scatter the new index of each particle into
+          // a dense array indexed by id
+          m_id_map_dense_size = max_id + 1;
+          m_id_map_key.clear();
+          m_id_map_value.resize(m_id_map_dense_size);
+          detail::fill(m_id_map_value.begin(), m_id_map_value.end(),
+                       detail::get_empty_id_map_value());
+
+          // before update range
+          if (update_start_index > 0) {
+            detail::scatter(Traits::make_counting_iterator(size_t(0)),
+                            Traits::make_counting_iterator(update_start_index),
+                            get<id>(begin), m_id_map_value.begin());
+          }
+
+          // update range, in the new order given by m_alive_indices
+          detail::scatter(Traits::make_counting_iterator(update_start_index),
+                          Traits::make_counting_iterator(update_start_index +
+                                                         m_alive_indices.size()),
+                          Traits::make_permutation_iterator(
+                              get<id>(begin), m_alive_indices.begin()),
+                          m_id_map_value.begin());
+        } else {
+          m_id_map_dense_size = 0;
+          m_id_map_key.resize(dead_and_alive_n - num_dead);
+          m_id_map_value.resize(dead_and_alive_n - num_dead);
+
+          // before update range
+          if (update_start_index > 0) {
+            detail::sequence(m_id_map_value.begin(),
+                             m_id_map_value.begin() + update_start_index);
+            detail::copy(get<id>(begin), get<id>(begin) + update_start_index,
+                         m_id_map_key.begin());
+          }
+
+          // update range
+          /*
+          detail::transform(m_alive_indices.begin(),m_alive_indices.end(),
+                       m_id_map_value.begin()+update_start_index,
+                       [&](const int index) {
+                          const int index_into_update = index -
+          update_start_index; const int num_dead_before_index = index_into_update
+          - m_alive_sum[index_into_update]; return index - num_dead_before_index;
+                       });
+                       */
+          detail::sequence(m_id_map_value.begin() + update_start_index,
+                           m_id_map_value.end(), update_start_index);
+          auto raw_id = iterator_to_raw_pointer(get<id>(begin));
+          detail::transform(
+              m_alive_indices.begin(), m_alive_indices.end(),
+              m_id_map_key.begin() + update_start_index,
+              [=] CUDA_HOST_DEVICE(const int index) { return raw_id[index]; });
+          detail::sort_by_key(m_id_map_key.begin(), m_id_map_key.end(),
+                              m_id_map_value.begin());
+        }
 #ifndef __CUDA_ARCH__
         if (4 <= ABORIA_LOG_LEVEL) {
           print_id_map();
@@ -487,10 +592,11 @@ public:
     query_type &query = cast().get_query_impl();
     query.m_id_map_key = iterator_to_raw_pointer(m_id_map_key.begin());
     query.m_id_map_value = iterator_to_raw_pointer(m_id_map_value.begin());
+    query.m_id_map_dense_size = m_id_map_dense_size;
     query.m_particles_begin = iterator_to_raw_pointer(m_particles_begin);
     query.m_particles_end = iterator_to_raw_pointer(m_particles_end);
 
-    return cast().ordered() || num_dead > 0;
+    return cast().order_changed_impl() || num_dead > 0;
   }
 
   ///
@@ -593,6 +699,18 @@ protected:
   ///
   bool m_id_map;
 
+  ///
+  /// @brief the size of the dense find-by-id map (largest id plus one), or
+  /// zero if the map is a sorted key/value pair
+  ///
+  size_t m_id_map_dense_size;
+
+  ///
+  /// @brief the find-by-id map is dense while the largest id is less than this
+  /// factor times the number of particles
+  ///
+  static constexpr size_t dense_id_map_factor = 4;
+
   ///
   /// @brief @Vector of bools indicating the periodicity of the domain
   ///
@@ -710,6 +828,7 @@ template <typename Traits> struct NeighbourQueryBase {
   ///
   /// @brief implement find-by-id
   ///
+  /// looks up the id in the dense id map if ids are compact, otherwise
   /// performs a binary search for the id in the map
   ///
   /// @param id the id of the particle to find
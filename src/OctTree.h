@@ -97,6 +97,12 @@ template <typename Traits> struct HyperOctreeQuery;
 /// | leaf   |  leaf   |                    |
 /// -----------------------------------------
 /// ~~~
+///
+/// The tree is built from the sorted 64-bit Morton codes of the points, so it
+/// has at most 64/D - 1 levels (e.g. 20 levels in three dimensions). Any
+/// bucket on the last level is a leaf, regardless of the number of particles
+/// it contains
+///
 /// @tparam Traits an instatiation of TraitsCommon
 ///
 template <typename Traits>
@@ -114,6 +120,8 @@ class HyperOctree : public neighbour_search_base<HyperOctree<Traits>, Traits,
   typedef typename Traits::vector_int vector_int;
   typedef typename Traits::unsigned_int_d unsigned_int_d;
   typedef typename Traits::template vector_type<vint2>::type vector_int2;
+  typedef detail::morton_code_type tag_type;
+  typedef typename Traits::template vector_type<tag_type>::type vector_tag;
   static const unsigned int dimension = Traits::dimension;
 
   // number of children = 2^d
@@ -128,7 +136,8 @@ class HyperOctree : public neighbour_search_base<HyperOctree<Traits>, Traits,
   friend base_type;
 
 public:
-  HyperOctree() : base_type(), m_max_level(32 / dimension - 2) {
+  HyperOctree()
+      : base_type(), m_max_level(detail::morton_code_max_level(dimension)) {
 
     // need to init a tree with 1 level (for 0 particles) in case
     // someone does a query on an empty data structure
@@ -203,6 +212,10 @@ private:
       /******************************************
        * 4. Sort according to classification    *
        ******************************************/
+      // sorting integer keys uses the (parallel) radix sort. The tags use
+      // dimension bits for each of the m_max_level levels, but particles
+      // that only fill part of the domain share their leading bits, so let
+      // the sort find the range of bits that actually vary
       detail::sort_by_key(m_tags.begin(), m_tags.end(),
                           this->m_alive_indices.begin());
     }
@@ -318,7 +331,7 @@ private:
   int m_max_level;
   unsigned m_number_of_levels;
 
-  vector_int m_tags;
+  vector_tag m_tags;
   vector_int m_nodes;
   vector_int2 m_leaves;
 
@@ -328,7 +341,7 @@ private:
 template <typename Traits> void HyperOctree<Traits>::build_tree() {
   m_nodes.clear();
   m_leaves.clear();
-  vector_int active_nodes(1, 0);
+  vector_tag active_nodes(1, 0);
 
   LOG(4, "octree: building tree with max_level = " << m_max_level);
 
@@ -343,7 +356,7 @@ template <typename Traits> void HyperOctree<Traits>::build_tree() {
      ******************************************/
 
     // New children: 2^D quadrants per active node
-    vector_int children(nchild * active_nodes.size());
+    vector_tag children(nchild * active_nodes.size());
 
     // For each active node, generate the tag mask for each of its 2^D children
     detail::tabulate(
@@ -362,9 +375,12 @@ template <typename Traits> void HyperOctree<Traits>::build_tree() {
     detail::lower_bound(m_tags.begin(), m_tags.end(), children.begin(),
                         children.end(), lower_bounds.begin());
 
-    int length = (1 << (m_max_level - level) * dimension) - 1;
+    const tag_type length =
+        (static_cast<tag_type>(1) << (m_max_level - level) * dimension) - 1;
 
-    auto plus_length = [=] CUDA_HOST_DEVICE(const int i) { return i + length; };
+    auto plus_length = [=] CUDA_HOST_DEVICE(const tag_type i) {
+      return i + length;
+    };
     detail::upper_bound(
         m_tags.begin(), m_tags.end(),
         Traits::make_transform_iterator(children.begin(), plus_length),
@@ -483,7 +499,7 @@ template <typename traits> struct HyperOctree<traits>::classify_point {
   classify_point(const bbox<dimension> &b, int lvl) : box(b), max_level(lvl) {}
 
   // Classify a point
-  inline CUDA_HOST_DEVICE int operator()(const double_d &p) {
+  inline CUDA_HOST_DEVICE tag_type operator()(const double_d &p) {
     return detail::point_to_tag(p, box, max_level);
   }
 };
@@ -494,14 +510,14 @@ template <typename traits> struct HyperOctree<traits>::child_index_to_tag_mask {
   // mask for lower n bits, where n is the number of dimensions
   const static unsigned mask = nchild - 1;
 
-  typedef typename vector_int::const_pointer ptr_type;
+  typedef typename vector_tag::const_pointer ptr_type;
   ptr_type m_nodes;
 
   child_index_to_tag_mask(int lvl, int max_lvl, ptr_type nodes)
       : level(lvl), max_level(max_lvl), m_nodes(nodes) {}
 
-  inline CUDA_HOST_DEVICE int operator()(int idx) const {
-    int tag = m_nodes[idx / nchild];
+  inline CUDA_HOST_DEVICE tag_type operator()(int idx) const {
+    const tag_type tag = m_nodes[idx / nchild];
     int which_child = (idx & mask);
     return detail::child_tag_mask(tag, which_child, level, max_level,
                                   dimension);
@@ -698,7 +714,8 @@ private:
 ///
 template <typename Traits> struct HyperOctreeQuery {
   const static unsigned int dimension = Traits::dimension;
-  const static unsigned int m_max_tree_depth = 32 / dimension - 2;
+  const static unsigned int m_max_tree_depth =
+      detail::morton_code_max_level(dimension);
 
   typedef Traits traits_type;
   typedef typename Traits::raw_pointer raw_pointer;
@@ -730,6 +747,7 @@ template <typename Traits> struct HyperOctreeQuery {
 
   size_t *m_id_map_key;
   size_t *m_id_map_value;
+  size_t m_id_map_dense_size;
 
   /*
    * functions for id mapping
@@ -737,14 +755,10 @@ template <typename Traits> struct HyperOctreeQuery {
   ABORIA_HOST_DEVICE_IGNORE_WARN
   CUDA_HOST_DEVICE
   raw_pointer find(const size_t id) const {
-    const size_t n = number_of_particles();
-    size_t *last = m_id_map_key + n;
-    size_t *first = detail::lower_bound(m_id_map_key, last, id);
-    if ((first != last) && !(id < *first)) {
-      return m_particles_begin + m_id_map_value[first - m_id_map_key];
-    } else {
-      return m_particles_begin + n;
-    }
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
   }
 
   ABORIA_HOST_DEVICE_IGNORE_WARN
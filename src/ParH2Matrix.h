@@ -83,10 +83,7 @@ class ParH2Matrix {
       vector_of_p2p_matrices_type;
   typedef typename traits_type::template vector_type<l2l_matrix_type>::type
       l2l_matrices_type;
-  typedef typename traits_type::template vector_type<m2l_matrix_type>::type
-      m2l_matrices_type;
-  typedef typename traits_type::template vector_type<m2l_matrices_type>::type
-      vector_of_m2l_matrices_type;
+  typedef detail::M2LMatrixCache<dimension, m2l_matrix_type> m2l_cache_type;
   typedef typename traits_type::template vector_type<size_t>::type indices_type;
   typedef typename traits_type::template vector_type<indices_type>::type
       vector_of_indices_type;
@@ -105,7 +102,8 @@ class ParH2Matrix {
   p2m_matrices_type m_p2m_matrices;
   l2l_matrices_type m_l2l_matrices;
   vector_of_p2p_matrices_type m_p2p_matrices;
-  vector_of_m2l_matrices_type m_m2l_matrices;
+  m2l_cache_type m_m2l_matrices;
+  vector_of_indices_type m_m2l_indices;
   vector_of_indices_type m_row_indices;
   vector_of_indices_type m_col_indices;
 
@@ -123,10 +121,18 @@ class ParH2Matrix {
   const size_t m_row_size;
 
 public:
+  /// if @p translation_invariant is true the kernel is assumed to depend only
+  /// on the difference between the two positions, and M2L matrices are
+  /// shared between box pairs with the same size and relative position. If
+  /// @p m2l_tolerance is positive the M2L matrices are stored in low-rank
+  /// form with this relative error (gen_extended_matrix() and related
+  /// functions then cannot be used)
   template <typename RowParticles>
   ParH2Matrix(const RowParticles &row_particles,
-              const ColParticles &col_particles, const Expansions &expansions)
-      : m_query(&col_particles.get_query()), m_expansions(expansions),
+              const ColParticles &col_particles, const Expansions &expansions,
+              const bool translation_invariant = false,
+              const double m2l_tolerance = 0)
+      : m_expansions(expansions), m_query(&col_particles.get_query()),
         m_col_particles(&col_particles), m_row_size(row_particles.size()) {
     // generate h2 matrix
     const size_t n = m_query->number_of_buckets();
@@ -139,7 +145,9 @@ public:
     m_W.resize(n);
     m_g.resize(n);
     m_l2l_matrices.resize(n);
-    m_m2l_matrices.resize(n);
+    m_m2l_indices.resize(n);
+    m_m2l_matrices.clear(m_query->get_bounds(), translation_invariant);
+    m_m2l_matrices.set_compression(m2l_tolerance);
     m_row_indices.resize(n);
     m_col_indices.resize(n);
     m_ext_indicies.resize(n);
@@ -162,12 +170,15 @@ public:
         m_row_indices[index].push_back(i);
       }
     }
-    for (auto &bucket : m_query->get_subtree()) {
-      if (m_query->is_leaf_node(bucket)) { // leaf node
-        const size_t index = m_query->get_bucket_index(bucket);
+    for (all_iterator bucket = m_query->get_subtree(); bucket != false;
+         ++bucket) {
+      if (m_query->is_leaf_node(*bucket)) { // leaf node
+        const size_t index = m_query->get_bucket_index(*bucket);
         // get target_index
-        for (auto &p : m_query->get_bucket_particles(bucket)) {
-          const size_t i = &get<position>(p) - &get<position>(col_particles)[0];
+        for (auto p = m_query->get_bucket_particles(*bucket); p != false;
+             ++p) {
+          const size_t i =
+              &get<position>(*p) - &get<position>(col_particles)[0];
           m_col_indices[index].push_back(i);
           if (row_equals_col) {
             m_row_indices[index].push_back(i);
@@ -187,7 +198,6 @@ public:
     // downward sweep of tree to generate level indicies and connectivity
     LOG(2, "\tgenerating connectivity_type...");
     for (child_iterator ci = m_query->get_children(); ci != false; ++ci) {
-      const box_type &target_box = m_query->get_bounds(ci);
       generate_levels(child_iterator_vector_type(), box_type(),
                       child_iterator(), ci, row_particles, col_particles, 0,
                       false);
@@ -206,10 +216,29 @@ public:
     */
     const size_t m_cut_level = 0;
 
+    // m2l matrix indices are assigned serially (so they don't depend on the
+    // number of threads), then the unique matrices are generated in parallel
+    LOG(2, "\tgenerating m2l matrices...");
+    for (size_t i = m_cut_level; i < m_levels.size(); ++i) {
+      for (const child_iterator &ci : m_levels[i]) {
+        const box_type &target_box = m_query->get_bounds(ci);
+        const size_t target_index = m_query->get_bucket_index(*ci);
+        // TODO: this is symmetric so could cut this effort in half
+        for (const auto &cj : m_weak_connectivity[target_index]) {
+          m_m2l_indices[target_index].push_back(
+              m_m2l_matrices.insert(target_box, m_query->get_bounds(cj)));
+        }
+      }
+    }
+    m_m2l_matrices.generate(m_expansions);
+    LOG(2, "\tusing " << m_m2l_matrices.size()
+                      << " M2L matrices, average rank "
+                      << m_m2l_matrices.average_rank());
+
     // generate matrices at each level
     LOG(2, "\tgenerating matrices...");
     // TODO: move generate_matricies to an external function
-    for (int i = m_cut_level; i < m_levels.size(); ++i) {
+    for (size_t i = m_cut_level; i < m_levels.size(); ++i) {
       detail::for_each(m_levels[i].begin(), m_levels[i].end(),
                        [&](const child_iterator &ci) {
                          generate_matrices(ci, row_particles, col_particles);
@@ -237,13 +266,14 @@ public:
         m_l2l_matrices(matrix.m_l2l_matrices),
         // m_p2p_matrices(matrix.m_p2p_matrices), \\going to redo these
         m_m2l_matrices(matrix.m_m2l_matrices),
+        m_m2l_indices(matrix.m_m2l_indices),
         // m_row_indices(matrix.m_row_indices), \\going to redo these
         m_col_indices(matrix.m_col_indices),
         m_parent_connectivity(matrix.m_parent_connectivity),
         m_strong_connectivity(matrix.m_strong_connectivity),
         m_weak_connectivity(matrix.m_weak_connectivity),
-        m_levels(matrix.m_levels), m_query(matrix.m_query),
-        m_expansions(matrix.m_expansions),
+        m_levels(matrix.m_levels), m_expansions(matrix.m_expansions),
+        m_query(matrix.m_query),
         m_col_particles(matrix.m_col_particles),
         m_row_size(row_particles.size()) {
     const size_t n = m_query->number_of_buckets();
@@ -410,8 +440,8 @@ private:
         if (m_query->is_leaf_node(*source)) {
           m_strong_connectivity[target_index].push_back(source);
         } else {
-          auto range = m_query->get_subtree(source);
-          for (all_iterator i = range.begin(); i != range.end(); ++i) {
+          for (all_iterator i = m_query->get_subtree(source); i != false;
+               ++i) {
             if (m_query->is_leaf_node(*i)) {
               m_strong_connectivity[target_index].push_back(
                   i.get_child_iterator());
@@ -443,16 +473,6 @@ private:
                               box_parent);
     }
 
-    // m2l
-    // TODO: this is symmetric so could cut this effort in half
-    for (const auto &cj : m_weak_connectivity[target_index]) {
-      size_t source_index = m_query->get_bucket_index(*cj);
-      const box_type &source_box = m_query->get_bounds(cj);
-      m_m2l_matrices[target_index].emplace_back();
-      m_expansions.M2L_matrix(*(m_m2l_matrices[target_index].end() - 1),
-                              target_box, source_box);
-    }
-
     if (m_query->is_leaf_node(*ci)) { // leaf node
       // p2m
       m_expansions.P2M_matrix(m_p2m_matrices[target_index], target_box,
@@ -538,7 +558,8 @@ private:
       size_t source_index = m_query->get_bucket_index(*source_ci);
       LOG(4, "calculate M2L between buckets " << target_index << " and "
                                               << source_index);
-      g += m_m2l_matrices[target_index][i] * m_W[source_index];
+      m_m2l_matrices.apply(m_m2l_indices[target_index][i], g,
+                           m_W[source_index]);
     }
 
     if (m_query->is_leaf_node(*ci)) { // leaf node
@@ -564,9 +585,12 @@ template <typename Expansions, typename RowParticlesType,
 ParH2Matrix<Expansions, ColParticlesType>
 make_h2_matrix(const RowParticlesType &row_particles,
                const ColParticlesType &col_particles,
-               const Expansions &expansions) {
-  return ParH2Matrix<Expansions, ColParticlesType>(row_particles, col_particles,
-                                                   expansions);
+               const Expansions &expansions,
+               const bool translation_invariant = false,
+               const double m2l_tolerance = 0) {
+  return ParH2Matrix<Expansions, ColParticlesType>(
+      row_particles, col_particles, expansions, translation_invariant,
+      m2l_tolerance);
 }
 
 #if 0
@@ -768,7 +792,7 @@ sparse_matrix_type ParH2Matrix<Expansions,ColParticles>::gen_extended_matrix() c
                     const size_t col_index = size_x + index*vector_size;
                     for (int im = 0; im < vector_size; ++im) {
                         for (int jm = 0; jm < vector_size; ++jm) {
-                            A.insert(row_index+im, col_index+jm) = m_m2l_matrices[i][j](im,jm);
+                            A.insert(row_index+im, col_index+jm) = m_m2l_matrices[m_m2l_indices[i][j]](im,jm);
                         }
                     }
                 }
@@ -1116,10 +1140,10 @@ sparse_matrix_type ParH2Matrix<Expansions,ColParticles>::gen_extended_matrix() c
                 const size_t col_index = size_x + index*vector_size;
                 for (int im = 0; im < vector_size; ++im) {
                     for (int jm = 0; jm < vector_size; ++jm) {
-                        if (m_m2l_matrices[i][j](im,jm) < 1e-10) {
-                            std::cout << "tooo small!!!!! "<<m_m2l_matrices[i][j](im,jm) << std::endl;
+                        if (m_m2l_matrices[m_m2l_indices[i][j]](im,jm) < 1e-10) {
+                            std::cout << "tooo small!!!!! "<<m_m2l_matrices[m_m2l_indices[i][j]](im,jm) << std::endl;
                         }
-                        A.insert(row_index+im, col_index+jm) = m_m2l_matrices[i][j](im,jm);
+                        A.insert(row_index+im, col_index+jm) = m_m2l_matrices[m_m2l_indices[i][j]](im,jm);
                     }
                 }
             }
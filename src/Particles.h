@@ -67,6 +67,7 @@ class Particles;
 #include "Traits.h"
 #include "Variable.h"
 #include "Vector.h"
+#include "VerletList.h"
 #include "Zip.h"
 #include "detail/Particles.h"
 //#include "OctTree.h"
@@ -80,7 +81,10 @@ namespace Aboria {
 ///  (for other variables such as velocity, density etc) and is
 ///  optionally embedded within a cuboidal spatial domain (for neighbourhood
 ///  searches) that can be periodic or not. Each particle also has its own
-///  random number generator that is seeded via its own unique id.
+///  random number generator that is seeded via its own unique id. Giving
+///  stateless_generator as the first variable type removes this stored
+///  generator, and random numbers are then drawn from counter-based streams
+///  (see make_generator()).
 ///
 ///  For example, the following creates a set of particles which each have
 ///  (along with the standard variables such as position, id etc) a
@@ -100,8 +104,8 @@ namespace Aboria {
 ///         are currently `std::vector` or `thrust::device_vector`.
 ///  \param SearchMethod (default `CellList`) an Aboria spatial
 ///         data structure. Valid options are `Aboria::CellList`,
-///         `Aboria::CellListOrdered`, `Aboria::Kdtree`, or
-///         `Aboria::HyperOctree`
+///         `Aboria::CellListOrdered`, `Aboria::CellListAdaptive`,
+///         `Aboria::Kdtree`, `Aboria::HyperOctree` or `Aboria::SpatialHash`
 ///  \param TRAITS_USER the class Aboria::Traits must be specialised on VECTOR
 ///
 ///  \see #ABORIA_VARIABLE
@@ -178,6 +182,10 @@ public:
   /// the query class that is associated with search_type
   typedef typename search_type::query_type query_type;
 
+  ///
+  /// the Verlet list type used by init_verlet_list()
+  typedef VerletList<traits_type> verlet_list_type;
+
   /// a boost mpl vector type containing a vector of Variable
   /// attached to the particles (includes position, id and
   /// alive flag as well as all user-supplied variables)
@@ -211,12 +219,17 @@ public:
   typedef typename traits_type::position position;
 
   /// Contructs an empty container with no searching or id tracking enabled
-  Particles() : next_id(0), searchable(false), seed(time(NULL)) {}
+  Particles()
+      : next_id(0), searchable(false), seed(time(NULL)), random_step(0),
+        update_count(0), sfc_curve(space_filling_curve::hilbert),
+        sfc_every_n_updates(0), cold_pending(false) {}
 
   /// Constructs a container with `size` particles. Searching or id tracking
   /// is disabled
   Particles(const size_t size)
-      : next_id(0), searchable(false), seed(time(NULL)) {
+      : next_id(0), searchable(false), seed(time(NULL)), random_step(0),
+        update_count(0), sfc_curve(space_filling_curve::hilbert),
+        sfc_every_n_updates(0), cold_pending(false) {
     resize(size);
   }
 
@@ -224,12 +237,19 @@ public:
   /// to \a *this
   Particles(const particles_type &other)
       : data(other.data), next_id(other.next_id), searchable(other.searchable),
-        seed(other.seed), search(other.search) {}
+        seed(other.seed), random_step(other.random_step),
+        update_count(other.update_count),
+        sfc_curve(other.sfc_curve),
+        sfc_every_n_updates(other.sfc_every_n_updates),
+        cold_pending(other.cold_pending), cold_order(other.cold_order),
+        search(other.search), verlet_list(other.verlet_list) {}
 
   /// range-based copy-constructor. performs deep copying of all
   /// particles from \p first to \p last
   Particles(iterator first, iterator last)
-      : data(traits_type::construct(first, last)), searchable(false), seed(0) {}
+      : data(traits_type::construct(first, last)), searchable(false), seed(0),
+        random_step(0), update_count(0), sfc_curve(space_filling_curve::hilbert),
+        sfc_every_n_updates(0), cold_pending(false) {}
 
   //
   // STL Container
@@ -268,8 +288,7 @@ public:
     // overwrite id, alive and random generator
     reference i = *(end() - 1);
     Aboria::get<id>(i) = this->next_id++;
-    Aboria::get<generator>(i) =
-        generator_type((seed + uint32_t(Aboria::get<id>(i))));
+    detail::seed_generator(i, seed);
     Aboria::get<alive>(i) = true;
 
     if (searchable && update_neighbour_search) {
@@ -293,6 +312,32 @@ public:
                      detail::set_seed_lambda<raw_reference>(seed));
   }
 
+  /// returns the base seed of the container \see set_seed()
+  uint32_t get_seed() const { return seed; }
+
+  /// returns the counter-based random stream for the particle with id \p id
+  /// at step \p step. The same base seed, \p id and \p step always give the
+  /// same stream, so no generator state needs to be stored. Containers
+  /// created with the stateless_generator tag use these streams in place of
+  /// the `generator` variable
+  generator_type make_generator(const size_t id, const size_t step) const {
+    return make_stream_generator(seed, id, step);
+  }
+
+  /// returns the counter-based random stream for the particle with id \p id
+  /// at the current random step \see get_random_step()
+  generator_type make_generator(const size_t id) const {
+    return make_generator(id, random_step);
+  }
+
+  /// Returns the current random step of the container. This is incremented
+  /// by next_random_step() and after each symbolic assignment to a variable of
+  /// this container, so that each evaluation draws from fresh streams
+  size_t get_random_step() const { return random_step; }
+
+  /// Increments the random step \see get_random_step()
+  void next_random_step() { ++random_step; }
+
   /// push a new particle with position \p position
   /// to the back of the container. All other variables for the new particle
   /// are left at the defaults
@@ -304,10 +349,16 @@ public:
 
   /// push the particles in \p particles to the back of the container
   void push_back(const particles_type &particles) {
+    ASSERT(!particles.cold_pending,
+           "source has a pending reorder of its cold variables");
     for (const value_type &i : particles) {
       this->push_back(i, false);
     }
-    update_positions(end() - particles.size(), end());
+    if (search.ordered()) {
+      update_positions(begin(), end());
+    } else {
+      update_positions(end() - particles.size(), end());
+    }
   }
 
   /// pop (delete) the particle at the end of the container
@@ -347,7 +398,10 @@ public:
   const_iterator cend() const { return traits_type::cend(data); }
 
   /// sets container to empty and deletes all particles
-  void clear() { return traits_type::clear(data); }
+  void clear() {
+    cold_pending = false;
+    return traits_type::clear(data);
+  }
 
   /// erase the particle pointed to by the iterator \p i.
   ///
@@ -393,7 +447,8 @@ public:
   /// container (e.g. the new container might have identical `id`s or
   /// `generators`, which are generally assumed to be unique).
   iterator insert(iterator position, const value_type &val) {
-    return traits_type::insert(data, position, val);
+    const size_t index = position - begin();
+    return traits_type::insert(data, begin() + index, val);
   }
 
   /// insert a \p n copies of the particle \p val into the container at \p
@@ -404,7 +459,8 @@ public:
   /// container (e.g. the new container might have identical `id`s or
   /// `generators`, which are generally assumed to be unique).
   void insert(iterator position, size_type n, const value_type &val) {
-    traits_type::insert(data, position, n, val);
+    const size_t index = position - begin();
+    traits_type::insert(data, begin() + index, n, val);
   }
 
   /// insert a range of particles pointed to by \p first and \p last at \p
@@ -454,6 +510,22 @@ public:
     searchable = true;
   }
 
+  /// Initialise the neighbourhood search for a search method that does not
+  /// need a domain, such as Aboria::SpatialHash. The domain is set to be
+  /// non-periodic and to cover all finite positions, so particles are never
+  /// removed for leaving the domain
+  ///
+  /// \param n_particles_in_leaf indicates the average, or maximum number of
+  /// particles in each leaf node of the search structure
+  void init_neighbour_search(const double n_particles_in_leaf = 10.0) {
+    static_assert(search_type::unbounded(),
+                  "this search method needs the domain bounds");
+    init_neighbour_search(
+        double_d::Constant(std::numeric_limits<double>::lowest()),
+        double_d::Constant(std::numeric_limits<double>::max()),
+        bool_d::Constant(false), n_particles_in_leaf);
+  }
+
   /// Initialise the "search by id" functionality. This will switch on the
   /// creation and updating of an internal data structure to enable search by
   /// id.
@@ -466,6 +538,36 @@ public:
     searchable = true;
   }
 
+  /// Initialise a Verlet (neighbour) list for the particle container. The list
+  /// holds, for each particle, the indices of all the other particles within a
+  /// distance \p cutoff + \p skin. It is automatically kept up to date by
+  /// update_positions(), which will permute the list if the particles are
+  /// reordered, and rebuild it only once twice the maximum distance moved by
+  /// any particle since the last build exceeds \p skin.
+  ///
+  /// Note that init_neighbour_search() must be called before this function
+  ///
+  /// \param cutoff the interaction cutoff distance
+  /// \param skin the extra distance that particles can move before the list
+  /// is rebuilt
+  /// \see get_verlet_list()
+  void init_verlet_list(const double cutoff, const double skin) {
+    LOG(2, "Particles:init_verlet_list: cutoff = " << cutoff
+                                                   << " skin = " << skin);
+    CHECK(searchable, "init_neighbour_search must be called before "
+                      "init_verlet_list");
+    verlet_list.set_radius(cutoff, skin);
+    verlet_list.update(search.get_query());
+  }
+
+  /// Returns the Verlet list of the container.
+  /// \see init_verlet_list()
+  const verlet_list_type &get_verlet_list() const {
+    ASSERT(verlet_list.enabled(),
+           "init_verlet_list not called on this particle set");
+    return verlet_list;
+  }
+
   /// Returns the query_type object that can be used for neighbourhood queries.
   /// This object is designed to be as lightweight as possible so that it can
   /// by copied (for example to the GPU)
@@ -474,6 +576,13 @@ public:
     return search.get_query();
   }
 
+  /// Returns the neighbour search data structure (e.g. to inspect how it was
+  /// last updated). Use get_query() to perform neighbourhood queries
+  const search_type &get_neighbour_search() const {
+    ASSERT(searchable, "init_neighbour_search not called on this particle set");
+    return search;
+  }
+
   /// takes an vector \p uncorrected_dx that might come from the difference
   /// between two particle positions, and returns the shortest possible dx,
   /// according to the periodicity of the domain
@@ -524,10 +633,13 @@ public:
   /// be the same as that returned by end()
   ///
   void update_positions(iterator update_begin, iterator update_end) {
-    if (search.update_positions(begin(), end(), update_begin, update_end)) {
-      reorder(update_begin, update_end, search.get_alive_indicies().begin(),
-              search.get_alive_indicies().end());
+    ++update_count;
+    update_search(update_begin, update_end);
+    if (sfc_every_n_updates > 0 && !search.ordered() &&
+        update_count % sfc_every_n_updates == 0) {
+      reorder_by_space_filling_curve(sfc_curve);
     }
+    flush_cold_variables();
   }
 
   /// Update the neighbourhood search data for all particles in the container
@@ -539,6 +651,52 @@ public:
   ///
   void update_positions() { update_positions(begin(), end()); }
 
+  /// Sort the particles in the container along the space filling curve \p
+  /// curve, which covers the bounding box of the particles. Particles that
+  /// are close in space will then be close in memory, reducing the cache
+  /// misses in neighbour searches. This is only useful for Aboria::CellList,
+  /// which leaves the particles in insertion order. For the other search
+  /// methods this function does nothing.
+  ///
+  /// All variables are permuted, and the neighbour search, id search and
+  /// Verlet list (if enabled) are updated to match. As particle indices
+  /// change, this counts as an update \see get_update_count()
+  ///
+  /// \param curve the space filling curve to sort along
+  /// \see set_space_filling_curve_sort()
+  void sort_by_space_filling_curve(
+      const space_filling_curve curve = space_filling_curve::hilbert) {
+    CHECK(searchable, "init_neighbour_search must be called before "
+                      "sort_by_space_filling_curve");
+    if (search.ordered()) {
+      LOG(2, "Particles: search is ordered, not sorting by space filling "
+             "curve");
+      return;
+    }
+    ++update_count;
+    reorder_by_space_filling_curve(curve);
+    flush_cold_variables();
+  }
+
+  /// Automatically call sort_by_space_filling_curve() every \p
+  /// every_n_updates calls to update_positions(). As the particles move, their
+  /// order in memory slowly loses its spatial locality, this restores it
+  /// periodically. Set \p every_n_updates to zero (the default) to switch
+  /// this off.
+  ///
+  /// \param curve the space filling curve to sort along
+  /// \param every_n_updates the number of updates between each sort
+  void set_space_filling_curve_sort(const space_filling_curve curve,
+                                    const size_t every_n_updates) {
+    sfc_curve = curve;
+    sfc_every_n_updates = every_n_updates;
+  }
+
+  /// Returns the number of times update_positions() has been called on this
+  /// container. This can be used to detect when any data derived from the
+  /// particle positions (e.g. a cached sparsity pattern) is out of date
+  size_t get_update_count() const { return update_count; }
+
   // Need to be mark as device to enable get functions being device/host
   CUDA_HOST_DEVICE
   const typename data_type::tuple_type &get_tuple() const {
@@ -697,31 +855,21 @@ private:
     LOG(2, "Particles: reordering particles");
     ASSERT(update_end == end(),
            "if triggering a reorder, should be updating the end");
+    const size_t update_start = update_begin - begin();
     const size_t n_update = update_end - update_begin;
     const size_t n_alive = order_end - order_start;
     const size_t old_n = size();
     const size_t new_n = old_n - (n_update - n_alive);
-    if (n_alive > old_n / 2) {
-      traits_type::resize(other_data, new_n);
-      // copy non-update region to other data buffer
-      detail::copy(begin(), update_begin, traits_type::begin(other_data));
-      // gather update_region according to order to other data buffer
-      detail::gather(order_start, order_end, traits_type::begin(data),
-                     traits_type::begin(other_data) + (update_begin - begin()));
-      // swap to using other data buffer
-      data.swap(other_data);
-      search.update_iterators(begin(), end());
-    } else {
-      traits_type::resize(other_data, n_alive);
-      // gather update_region to other buffer
-      detail::gather(order_start, order_end, traits_type::begin(data),
-                     traits_type::begin(other_data));
-      traits_type::resize(data, new_n);
-      // copy other buffer back to current data buffer
-      detail::copy(traits_type::begin(other_data), traits_type::end(other_data),
-                   update_begin);
-      search.update_iterators(begin(), end());
+    // a gather into the other buffer followed by a swap is quicker, unless
+    // most of the particles have been deleted
+    const bool swap_buffers = n_alive > old_n / 2;
+    reorder_variables(update_start, new_n, swap_buffers, order_start, order_end,
+                      detail::make_index_sequence<traits_type::N>());
+    if (has_cold_variables) {
+      defer_cold_reorder(update_start, order_start, order_end);
     }
+    search.update_iterators(begin(), end());
+    verlet_list.reorder(update_start, order_start, order_end);
     if (ABORIA_LOG_LEVEL >= 4) {
       std::cout << "particle ids:\n";
       for (auto i = begin(); i != end(); ++i) {
@@ -731,6 +879,201 @@ private:
     }
   }
 
+  /// Used by update_positions(). Updates the neighbour search and Verlet list
+  /// for particles between \p update_begin and \p update_end, reordering the
+  /// particles if required by the search data structure
+  void update_search(iterator update_begin, iterator update_end) {
+    if (search.update_positions(begin(), end(), update_begin, update_end)) {
+      reorder(update_begin, update_end, search.get_alive_indicies().begin(),
+              search.get_alive_indicies().end());
+    }
+    if (verlet_list.enabled()) {
+      verlet_list.update(search.get_query());
+    }
+  }
+
+  /// Used by sort_by_space_filling_curve(). Sorts all the particles by their
+  /// index along \p curve, then rebuilds the neighbour search
+  void reorder_by_space_filling_curve(const space_filling_curve curve) {
+    const size_t n = size();
+    if (n == 0) {
+      return;
+    }
+    LOG(2, "Particles: sorting particles by space filling curve");
+
+    typedef bbox<dimension> box_type;
+    const box_type bounds =
+        detail::reduce(get<position>(begin()), get<position>(end()),
+                       box_type(), [](box_type a, const box_type &b) {
+                         return a + b;
+                       });
+
+    // every level of the curve uses dimension bits of the key
+    const int max_level = detail::morton_code_max_level(dimension);
+    typename traits_type::template vector_type<
+        detail::morton_code_type>::type keys(n);
+    if (curve == space_filling_curve::hilbert) {
+      detail::transform(get<position>(begin()), get<position>(end()),
+                        keys.begin(),
+                        [=] CUDA_HOST_DEVICE(const double_d &p) {
+                          return detail::point_to_hilbert_index(p, bounds,
+                                                                max_level);
+                        });
+    } else {
+      detail::transform(get<position>(begin()), get<position>(end()),
+                        keys.begin(),
+                        [=] CUDA_HOST_DEVICE(const double_d &p) {
+                          return detail::point_to_tag(p, bounds, max_level);
+                        });
+    }
+
+    vector_int order(n);
+    detail::sequence(order.begin(), order.end());
+    detail::sort_by_key(keys.begin(), keys.end(), order.begin(),
+                        dimension * max_level);
+    reorder(begin(), end(), order.begin(), order.end());
+
+    // the index of every id has changed, so force a rebuild of the id map
+    if (search.get_id_map()) {
+      search.init_id_map();
+    }
+    update_search(begin(), end());
+  }
+
+  /// true if the variable at index \p I of the particle tuple is cold
+  /// \see ABORIA_COLD_VARIABLE
+  template <size_t I>
+  using is_cold_index =
+      std::integral_constant<bool,
+                             mpl::at_c<mpl_type_vector, I>::type::cold>;
+
+  template <size_t... I>
+  static constexpr bool any_cold(detail::index_sequence<I...>) {
+    const bool cold[] = {false, is_cold_index<I>::value...};
+    for (bool c : cold) {
+      if (c) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// true if any of the variables are cold
+  static constexpr bool has_cold_variables =
+      any_cold(detail::make_index_sequence<traits_type::N>());
+
+  /// Used by reorder(). Gathers the variable at index \p I according to the
+  /// \p order_start and \p order_end range
+  template <size_t I>
+  void reorder_variable(const size_t update_start, const size_t new_n,
+                        const bool swap_buffers,
+                        const typename vector_int::const_iterator &order_start,
+                        const typename vector_int::const_iterator &order_end,
+                        std::false_type) {
+    auto &variable = get_by_index<I>(data);
+    auto &other_variable = get_by_index<I>(other_data);
+    if (swap_buffers) {
+      other_variable.resize(new_n);
+      // copy non-update region to other data buffer
+      detail::copy(variable.begin(), variable.begin() + update_start,
+                   other_variable.begin());
+      // gather update_region according to order to other data buffer
+      detail::gather(order_start, order_end, variable.begin(),
+                     other_variable.begin() + update_start);
+      // swap to using other data buffer
+      variable.swap(other_variable);
+    } else {
+      // gather update_region to other buffer
+      other_variable.resize(order_end - order_start);
+      detail::gather(order_start, order_end, variable.begin(),
+                     other_variable.begin());
+      variable.resize(new_n);
+      // copy other buffer back to current data buffer
+      detail::copy(other_variable.begin(), other_variable.end(),
+                   variable.begin() + update_start);
+    }
+  }
+
+  /// Used by reorder(). Cold variables are not gathered here
+  /// \see defer_cold_reorder()
+  template <size_t I>
+  void reorder_variable(const size_t, const size_t, const bool,
+                        const typename vector_int::const_iterator &,
+                        const typename vector_int::const_iterator &,
+                        std::true_type) {}
+
+  template <size_t... I>
+  void reorder_variables(const size_t update_start, const size_t new_n,
+                         const bool swap_buffers,
+                         const typename vector_int::const_iterator &order_start,
+                         const typename vector_int::const_iterator &order_end,
+                         detail::index_sequence<I...>) {
+    int dummy[] = {0, (reorder_variable<I>(update_start, new_n, swap_buffers,
+                                           order_start, order_end,
+                                           is_cold_index<I>()),
+                       void(), 0)...};
+    static_cast<void>(dummy);
+  }
+
+  /// Used by reorder(). Composes the reordering given by \p order_start and
+  /// \p order_end with the pending reordering of the cold variables, so that
+  /// cold variable `i` is stored at index `cold_order[i]`
+  void defer_cold_reorder(const size_t update_start,
+                          const typename vector_int::const_iterator &order_start,
+                          const typename vector_int::const_iterator &order_end) {
+    const size_t new_n = update_start + (order_end - order_start);
+    other_cold_order.resize(new_n);
+    if (cold_pending) {
+      detail::copy(cold_order.begin(), cold_order.begin() + update_start,
+                   other_cold_order.begin());
+      detail::gather(order_start, order_end, cold_order.begin(),
+                     other_cold_order.begin() + update_start);
+    } else {
+      detail::sequence(other_cold_order.begin(),
+                       other_cold_order.begin() + update_start);
+      detail::copy(order_start, order_end,
+                   other_cold_order.begin() + update_start);
+    }
+    cold_order.swap(other_cold_order);
+    cold_pending = true;
+  }
+
+  /// Used by update_positions() and sort_by_space_filling_curve(). Applies
+  /// the reordering of the cold variables that has been composed over all
+  /// the reorders of this update, so that no reorder is pending once the
+  /// particles are accessed
+  void flush_cold_variables() {
+    if (!cold_pending) {
+      return;
+    }
+    LOG(2, "Particles: applying deferred reorder to cold variables");
+    flush_cold_variables_impl(detail::make_index_sequence<traits_type::N>());
+    cold_order.clear();
+    cold_pending = false;
+    // the cold variables have been swapped into new buffers
+    search.update_iterators(begin(), end());
+  }
+
+  /// Used by flush_cold_variables(). Gathers the cold variable at index \p I
+  /// according to #cold_order
+  template <size_t I> void flush_cold_variable(std::true_type) {
+    auto &variable = get_by_index<I>(data);
+    auto &other_variable = get_by_index<I>(other_data);
+    other_variable.resize(cold_order.size());
+    detail::gather(cold_order.begin(), cold_order.end(), variable.begin(),
+                   other_variable.begin());
+    variable.swap(other_variable);
+  }
+
+  template <size_t I> void flush_cold_variable(std::false_type) {}
+
+  template <size_t... I>
+  void flush_cold_variables_impl(detail::index_sequence<I...>) {
+    int dummy[] = {
+        0, (flush_cold_variable<I>(is_cold_index<I>()), void(), 0)...};
+    static_cast<void>(dummy);
+  }
+
   template <class InputIterator>
   iterator insert_dispatch(iterator position, InputIterator first,
                            InputIterator last, std::false_type) {
@@ -747,7 +1090,8 @@ private:
   template <class InputIterator>
   iterator insert_dispatch(iterator position, InputIterator first,
                            InputIterator last, std::true_type) {
-    return traits_type::insert(data, position, first, last);
+    const size_t index = position - begin();
+    return traits_type::insert(data, begin() + index, first, last);
   }
 
   /// Contains the particle data, implemented as a std::tuple of Level 0 vectors
@@ -765,15 +1109,80 @@ private:
   /// The base random seed for the container
   uint32_t seed;
 
+  /// The step counter used for the counter-based random streams
+  /// \see get_random_step()
+  size_t random_step;
+
+  /// The number of calls to update_positions() \see get_update_count()
+  size_t update_count;
+
+  /// The curve used by the automatic space filling curve sort
+  /// \see set_space_filling_curve_sort()
+  space_filling_curve sfc_curve;
+
+  /// The number of updates between each automatic space filling curve sort,
+  /// or zero if switched off \see set_space_filling_curve_sort()
+  size_t sfc_every_n_updates;
+
+  /// True if the cold variables have a deferred reorder
+  /// \see flush_cold_variables()
+  bool cold_pending;
+
+  /// The deferred reorder of the cold variables, cold variable `i` is
+  /// currently stored at index `cold_order[i]`
+  vector_int cold_order;
+
+  /// A secondary buffer used to compose #cold_order
+  vector_int other_cold_order;
+
   /// The neighbourhood search data structure
   search_type search;
 
+  /// The Verlet list \see init_verlet_list()
+  verlet_list_type verlet_list;
+
 #ifdef HAVE_VTK
   /// An vtkUnstructuredGrid to store particle data in (if neccessary)
   vtkSmartPointer<vtkUnstructuredGrid> cache_grid;
 #endif
 };
 
+///
+/// @brief get a variable from a @ref Particles container
+///
+/// @tparam T the variable type to get, @see ABORIA_VARIABLE
+/// @param arg the particle container
+///
+template <typename T, typename VAR, unsigned int DomainD,
+          template <typename, typename> class VECTOR,
+          template <typename> class SearchMethod, typename TRAITS_USER>
+typename Particles<VAR, DomainD, VECTOR, SearchMethod,
+                   TRAITS_USER>::template return_type<T>::type &
+get(Particles<VAR, DomainD, VECTOR, SearchMethod, TRAITS_USER> &arg) {
+  typedef Particles<VAR, DomainD, VECTOR, SearchMethod, TRAITS_USER>
+      particles_type;
+  return detail::get_impl<particles_type::template elem_by_type<T>::index>(
+      arg.get_tuple());
+}
+
+///
+/// @brief get a variable from a const @ref Particles container
+///
+/// @tparam T the variable type to get, @see ABORIA_VARIABLE
+/// @param arg the particle container
+///
+template <typename T, typename VAR, unsigned int DomainD,
+          template <typename, typename> class VECTOR,
+          template <typename> class SearchMethod, typename TRAITS_USER>
+typename Particles<VAR, DomainD, VECTOR, SearchMethod,
+                   TRAITS_USER>::template return_type<T>::type const &
+get(const Particles<VAR, DomainD, VECTOR, SearchMethod, TRAITS_USER> &arg) {
+  typedef Particles<VAR, DomainD, VECTOR, SearchMethod, TRAITS_USER>
+      particles_type;
+  return detail::get_impl<particles_type::template elem_by_type<T>::index>(
+      arg.get_tuple());
+}
+
 } // namespace Aboria
 
 #endif /* SPECIES_H_ */
@@ -36,6 +36,7 @@
 #ifndef SITMO_PRNG_ENGINE_HPP
 #define SITMO_PRNG_ENGINE_HPP
 #include <iostream>
+#include <utility>
 
 #include "CudaInclude.h"
 #include <boost/serialization/nvp.hpp>
@@ -72,8 +73,55 @@ typedef thrust::detail::uint32_t uint32_t; // nvcc
   x1 ^= x0;                                                                    \
   z1 ^= z0;
 
+// Number of 64 bit lanes used by prng_engine::generate() to encrypt several
+// counters at once, chosen from the widest vector instruction set enabled at
+// compile time. If undefined, generate() encrypts one counter at a time.
+#if !defined(SITMO_SIMD_LANES) && defined(__GNUC__) && !defined(__CUDA_ARCH__)
+#if defined(__AVX512F__)
+#define SITMO_SIMD_LANES 8
+#elif defined(__AVX2__)
+#define SITMO_SIMD_LANES 4
+#elif defined(__SSE2__)
+#define SITMO_SIMD_LANES 2
+#endif
+#endif
+
 namespace sitmo {
 
+// Encrypts the counter \p b with key \p k (k[4] is the parity word). T is
+// either uint64_t or a vector of uint64_t, holding one counter per lane, so
+// that the scalar and the SIMD code paths share the same rounds
+template <typename T>
+CUDA_HOST_DEVICE inline void threefish_encrypt(T b[4], const uint64_t k[5]) {
+  MIXK(b[0], b[1], 14, b[2], b[3], 16, k[0], k[1], k[2], k[3]);
+  MIX2(b[0], b[3], 52, b[2], b[1], 57);
+  MIX2(b[0], b[1], 23, b[2], b[3], 40);
+  MIX2(b[0], b[3], 5, b[2], b[1], 37);
+  MIXK(b[0], b[1], 25, b[2], b[3], 33, k[1], k[2], k[3], k[4] + 1);
+  MIX2(b[0], b[3], 46, b[2], b[1], 12);
+  MIX2(b[0], b[1], 58, b[2], b[3], 22);
+  MIX2(b[0], b[3], 32, b[2], b[1], 32);
+
+  MIXK(b[0], b[1], 14, b[2], b[3], 16, k[2], k[3], k[4], k[0] + 2);
+  MIX2(b[0], b[3], 52, b[2], b[1], 57);
+  MIX2(b[0], b[1], 23, b[2], b[3], 40);
+  MIX2(b[0], b[3], 5, b[2], b[1], 37);
+  MIXK(b[0], b[1], 25, b[2], b[3], 33, k[3], k[4], k[0], k[1] + 3);
+
+  MIX2(b[0], b[3], 46, b[2], b[1], 12);
+  MIX2(b[0], b[1], 58, b[2], b[3], 22);
+  MIX2(b[0], b[3], 32, b[2], b[1], 32);
+
+  MIXK(b[0], b[1], 14, b[2], b[3], 16, k[4], k[0], k[1], k[2] + 4);
+  MIX2(b[0], b[3], 52, b[2], b[1], 57);
+  MIX2(b[0], b[1], 23, b[2], b[3], 40);
+  MIX2(b[0], b[3], 5, b[2], b[1], 37);
+
+  for (unsigned short i = 0; i < 4; ++i)
+    b[i] += k[i];
+  b[3] += 5;
+}
+
 // enable_if for C__98 compilers
 template <bool C, typename T = void> struct sitmo_enable_if { typedef T type; };
 
@@ -215,6 +263,31 @@ public:
     return _o[0] & 0xFFFFFFFF; // this call
   }
 
+  // Writes the next \p n outputs to \p out, leaving the engine in the same
+  // state as \p n calls to operator(). Whole blocks are encrypted several
+  // counters at a time (see SITMO_SIMD_LANES)
+  void generate(uint32_t *out, size_t n) {
+    // use up the current block
+    for (; n > 0 && _o_counter < 8; --n) {
+      *out++ = (*this)();
+    }
+
+    const uint64_t n_blocks = n / 8;
+    if (n_blocks > 0 && n_blocks <= 0xFFFFFFFFFFFFFFFF - _s[0]) {
+      encrypt_blocks(out, n_blocks);
+      _s[0] += n_blocks;
+      encrypt_counter();
+      _o_counter = 8;
+      out += 8 * n_blocks;
+      n -= 8 * n_blocks;
+    }
+
+    // remaining partial block, or everything if the counter would overflow
+    for (; n > 0; --n) {
+      *out++ = (*this)();
+    }
+  }
+
   // -------------------------------------------------
   // misc
   // -------------------------------------------------
@@ -320,45 +393,72 @@ public:
   }
 
 private:
+  CUDA_HOST_DEVICE
+  void set_parity_key(uint64_t k[5]) const {
+    for (unsigned short i = 0; i < 4; ++i)
+      k[i] = _k[i];
+    k[4] = 0x1BD11BDAA9FC1A22 ^ k[0] ^ k[1] ^ k[2] ^ k[3];
+  }
+
   CUDA_HOST_DEVICE
   void encrypt_counter() {
-    uint64_t b[4];
     uint64_t k[5];
+    set_parity_key(k);
 
     for (unsigned short i = 0; i < 4; ++i)
-      b[i] = _s[i];
-    for (unsigned short i = 0; i < 4; ++i)
-      k[i] = _k[i];
+      _o[i] = _s[i];
+    threefish_encrypt(_o, k);
+  }
 
-    k[4] = 0x1BD11BDAA9FC1A22 ^ k[0] ^ k[1] ^ k[2] ^ k[3];
+  // write the 8 outputs of the encrypted block \p o to \p out, in the order
+  // returned by operator()
+  static void write_block(uint32_t *out, const uint64_t o0, const uint64_t o1,
+                          const uint64_t o2, const uint64_t o3) {
+    out[0] = o0 & 0xFFFFFFFF;
+    out[1] = o0 >> 32;
+    out[2] = o1 & 0xFFFFFFFF;
+    out[3] = o1 >> 32;
+    out[4] = o2 & 0xFFFFFFFF;
+    out[5] = o2 >> 32;
+    out[6] = o3 & 0xFFFFFFFF;
+    out[7] = o3 >> 32;
+  }
 
-    MIXK(b[0], b[1], 14, b[2], b[3], 16, k[0], k[1], k[2], k[3]);
-    MIX2(b[0], b[3], 52, b[2], b[1], 57);
-    MIX2(b[0], b[1], 23, b[2], b[3], 40);
-    MIX2(b[0], b[3], 5, b[2], b[1], 37);
-    MIXK(b[0], b[1], 25, b[2], b[3], 33, k[1], k[2], k[3], k[4] + 1);
-    MIX2(b[0], b[3], 46, b[2], b[1], 12);
-    MIX2(b[0], b[1], 58, b[2], b[3], 22);
-    MIX2(b[0], b[3], 32, b[2], b[1], 32);
-
-    MIXK(b[0], b[1], 14, b[2], b[3], 16, k[2], k[3], k[4], k[0] + 2);
-    MIX2(b[0], b[3], 52, b[2], b[1], 57);
-    MIX2(b[0], b[1], 23, b[2], b[3], 40);
-    MIX2(b[0], b[3], 5, b[2], b[1], 37);
-    MIXK(b[0], b[1], 25, b[2], b[3], 33, k[3], k[4], k[0], k[1] + 3);
-
-    MIX2(b[0], b[3], 46, b[2], b[1], 12);
-    MIX2(b[0], b[1], 58, b[2], b[3], 22);
-    MIX2(b[0], b[3], 32, b[2], b[1], 32);
-
-    MIXK(b[0], b[1], 14, b[2], b[3], 16, k[4], k[0], k[1], k[2] + 4);
-    MIX2(b[0], b[3], 52, b[2], b[1], 57);
-    MIX2(b[0], b[1], 23, b[2], b[3], 40);
-    MIX2(b[0], b[3], 5, b[2], b[1], 37);
-
-    for (unsigned int i = 0; i < 4; ++i)
-      _o[i] = b[i] + k[i];
-    _o[3] += 5;
+#ifdef SITMO_SIMD_LANES
+  // the vector {1, 2, ..., number of lanes}
+  template <typename Lanes, std::size_t... L>
+  static Lanes lane_offsets(std::index_sequence<L...>) {
+    return Lanes{(L + 1)...};
+  }
+#endif
+
+  // encrypt the \p n blocks following the current counter and write them to
+  // \p out. Assumes that the first word of the counter does not overflow
+  void encrypt_blocks(uint32_t *out, const uint64_t n) const {
+    uint64_t k[5];
+    set_parity_key(k);
+
+    uint64_t i = 0;
+#ifdef SITMO_SIMD_LANES
+    typedef uint64_t lanes_type
+        __attribute__((vector_size(8 * SITMO_SIMD_LANES)));
+    // the offset of each lane's counter from the first, {1, 2, ...}
+    const lanes_type lane_offset = lane_offsets<lanes_type>(
+        std::make_index_sequence<SITMO_SIMD_LANES>());
+    for (; i + SITMO_SIMD_LANES <= n; i += SITMO_SIMD_LANES) {
+      lanes_type b[4] = {lane_offset + (_s[0] + i), lanes_type{} + _s[1],
+                         lanes_type{} + _s[2], lanes_type{} + _s[3]};
+      threefish_encrypt(b, k);
+      for (unsigned short l = 0; l < SITMO_SIMD_LANES; ++l) {
+        write_block(out + 8 * (i + l), b[0][l], b[1][l], b[2][l], b[3][l]);
+      }
+    }
+#endif
+    for (; i < n; ++i) {
+      uint64_t b[4] = {_s[0] + i + 1, _s[1], _s[2], _s[3]};
+      threefish_encrypt(b, k);
+      write_block(out + 8 * i, b[0], b[1], b[2], b[3]);
+    }
   }
 
   CUDA_HOST_DEVICE
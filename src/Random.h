@@ -2,10 +2,172 @@
 #define RANDOM_H_
 
 #include "PrngEngine.h"
+#include <cmath>
 
 namespace Aboria {
 
 typedef sitmo::prng_engine generator_type;
+
+/// Returns the counter-based random stream identified by \p seed, \p id and
+/// \p step. The stream depends only on these three values, so it can be
+/// recreated on demand rather than stored
+CUDA_HOST_DEVICE
+inline generator_type make_stream_generator(const uint32_t seed,
+                                            const uint64_t id,
+                                            const uint64_t step) {
+  generator_type gen;
+  gen.set_key(seed, id);
+  gen.set_counter(0, step);
+  return gen;
+}
+
+/// Fills \p out with \p n uniform doubles in [0,1) from \p gen. Each double
+/// takes 53 bits from two consecutive outputs of \p gen, which are generated
+/// in bulk using prng_engine::generate()
+inline void generate_uniform(generator_type &gen, double *out, size_t n) {
+  const size_t chunk = 128;
+  uint32_t buffer[2 * chunk];
+  while (n > 0) {
+    const size_t m = n < chunk ? n : chunk;
+    gen.generate(buffer, 2 * m);
+    for (size_t i = 0; i < m; ++i) {
+      const uint64_t x =
+          (static_cast<uint64_t>(buffer[2 * i + 1]) << 32) | buffer[2 * i];
+      out[i] = (x >> 11) * (1.0 / 9007199254740992.0);
+    }
+    out += m;
+    n -= m;
+  }
+}
+
+/// A standard normal distribution using the Ziggurat method of Marsaglia and
+/// Tsang, with the rejection step of Doornik. Most samples need a single
+/// 64 bit draw, a table lookup and a multiply, and no transcendental
+/// functions. The sequence of samples depends only on the sequence of
+/// outputs of the engine, so each particle's stream gives the same normals
+/// regardless of the number of threads
+class ziggurat_normal_distribution {
+  static const unsigned int n_layers = 256;
+
+  struct table_type {
+    double x[n_layers + 1];
+    double ratio[n_layers];
+
+    table_type() {
+      const double r = tail_start();
+      const double v = 4.92867323399e-3;
+      x[0] = v / std::exp(-0.5 * r * r);
+      x[1] = r;
+      for (unsigned int i = 1; i < n_layers - 1; ++i) {
+        x[i + 1] = std::sqrt(
+            -2.0 * std::log(v / x[i] + std::exp(-0.5 * x[i] * x[i])));
+      }
+      x[n_layers] = 0;
+      for (unsigned int i = 0; i < n_layers; ++i) {
+        ratio[i] = x[i + 1] / x[i];
+      }
+    }
+  };
+
+  static double tail_start() { return 3.6541528853610088; }
+
+  static const table_type &get_table() {
+    static const table_type table;
+    return table;
+  }
+
+  /// uniform double in [0,1) from the top 53 bits of \p w
+  static double to_uniform(const uint64_t w) {
+    return (w >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  /// sample from the tail beyond tail_start()
+  template <typename NextWord>
+  static double sample_tail(NextWord &next, const bool negative) {
+    const double r = tail_start();
+    double x, y;
+    do {
+      // 1 - u is in (0,1], so the logs are finite
+      x = std::log(1.0 - to_uniform(next())) / r;
+      y = std::log(1.0 - to_uniform(next()));
+    } while (-2.0 * y < x * x);
+    return negative ? x - r : r - x;
+  }
+
+public:
+  typedef double result_type;
+
+  /// returns a sample using the 64 bit words returned by \p next
+  template <typename NextWord> static double sample(NextWord &next) {
+    const table_type &table = get_table();
+    for (;;) {
+      const uint64_t w = next();
+      // the layer uses the low 8 bits, the uniform the top 53 bits
+      const unsigned int i = w & (n_layers - 1);
+      const double u = 2.0 * to_uniform(w) - 1.0;
+      if (std::abs(u) < table.ratio[i]) {
+        return u * table.x[i];
+      }
+      if (i == 0) {
+        return sample_tail(next, u < 0);
+      }
+      const double x = u * table.x[i];
+      const double f0 = std::exp(-0.5 * (table.x[i] * table.x[i] - x * x));
+      const double f1 =
+          std::exp(-0.5 * (table.x[i + 1] * table.x[i + 1] - x * x));
+      if (f1 + to_uniform(next()) * (f0 - f1) < 1.0) {
+        return x;
+      }
+    }
+  }
+
+  /// returns a sample from \p gen, a 32 bit engine such as generator_type.
+  /// Each 64 bit word is made from two consecutive outputs, the first
+  /// giving the low bits
+  template <typename Generator> double operator()(Generator &gen) const {
+    auto next = [&gen]() {
+      const uint64_t low = gen();
+      const uint64_t high = gen();
+      return (high << 32) | low;
+    };
+    return sample(next);
+  }
+};
+
+namespace detail {
+/// returns 64 bit words made from consecutive outputs of a generator_type,
+/// which are generated in bulk using prng_engine::generate()
+class bulk_words {
+  static const size_t chunk = 256;
+  generator_type &m_gen;
+  size_t m_index;
+  uint32_t m_buffer[2 * chunk];
+
+public:
+  bulk_words(generator_type &gen) : m_gen(gen), m_index(chunk) {}
+
+  uint64_t operator()() {
+    if (m_index == chunk) {
+      m_gen.generate(m_buffer, 2 * chunk);
+      m_index = 0;
+    }
+    const uint64_t low = m_buffer[2 * m_index];
+    const uint64_t high = m_buffer[2 * m_index + 1];
+    ++m_index;
+    return (high << 32) | low;
+  }
+};
+} // namespace detail
+
+/// Fills \p out with \p n standard normal doubles from \p gen using
+/// ziggurat_normal_distribution. The outputs of \p gen are generated in
+/// chunks, so \p gen may be left past the last output used
+inline void generate_normal(generator_type &gen, double *out, size_t n) {
+  detail::bulk_words next(gen);
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = ziggurat_normal_distribution::sample(next);
+  }
+}
 }
 
 #endif // RANDOM_H_
@@ -54,6 +54,8 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cmath>
 #include <iostream>
 #include <queue>
+#include <type_traits>
+#include <vector>
 
 namespace Aboria {
 
@@ -153,6 +155,29 @@ public:
     return periodic_iterator_type(start, end);
   }
 
+  ///
+  /// @brief returns iterator for the periodic images of the search point @p r
+  /// that need to be searched, i.e. only those images whose search region
+  /// overlaps the domain @p bounds. For points further than @p max_distance
+  /// from every periodic boundary this is just the original point
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  static periodic_iterator_type
+  get_periodic_range(const bool_d is_periodic, const bbox<dimension> &bounds,
+                     const double_d &r, const double max_distance) {
+    int_d start, end;
+    for (size_t i = 0; i < dimension; ++i) {
+      // the image at r - L overlaps the domain if r + max_distance reaches
+      // the upper boundary, and the image at r + L if r - max_distance
+      // reaches the lower boundary
+      start[i] =
+          is_periodic[i] && r[i] + max_distance >= bounds.bmax[i] ? -1 : 0;
+      end[i] = is_periodic[i] && r[i] - max_distance <= bounds.bmin[i] ? 2 : 1;
+    }
+    return periodic_iterator_type(start, end);
+  }
+
   ///
   /// @brief constructs an invalid iterator that can be used as an end()
   /// iterator
@@ -178,7 +203,8 @@ public:
         m_max_distance2(
             detail::distance_helper<LNormNumber>::get_value_to_accumulate(
                 max_distance)),
-        m_current_periodic(get_periodic_range(m_query->get_periodic())),
+        m_current_periodic(get_periodic_range(
+            m_query->get_periodic(), m_query->get_bounds(), r, max_distance)),
         m_current_point(
             r + (*m_current_periodic) *
                     (m_query->get_bounds().bmax - m_query->get_bounds().bmin)),
@@ -837,6 +863,546 @@ euclidean_search(const Query &query, const typename Query::double_d &centre,
   return SearchIterator(query, centre, max_distance);
 }
 
+///
+/// @brief calls a function for every particle within a given distance around
+/// a point
+///
+/// This finds the same particles, in the same order, as iterating through
+/// distance_search(), but loops directly over the periodic images, candidate
+/// buckets and their particles rather than stepping through the state machine
+/// of a @ref search_iterator, so the compiler is free to inline @p f into the
+/// inner loop. Use this in performance critical loops that do not need an
+/// iterator.
+///
+/// @tparam LNormNumber the norm to use (defaults to 2, the euclidean distance)
+/// @tparam Query the query object type
+/// @tparam F function object type
+/// @param query the query object
+/// @param centre the central point of the search
+/// @param max_distance the maximum distance to search around @p centre
+/// @param f function object called as `f(b, dx)`, where `b` is a reference to
+/// the particle and `dx` is the vector $r_b-r_a$ between the particle and
+/// (the periodic image of) @p centre
+///
+template <int LNormNumber = 2, typename Query, typename F>
+ABORIA_HOST_DEVICE_IGNORE_WARN CUDA_HOST_DEVICE void
+for_each_neighbour(const Query &query, const typename Query::double_d &centre,
+                   const double max_distance, F f) {
+  typedef typename Query::traits_type traits_type;
+  typedef typename traits_type::position position;
+  typedef typename Query::double_d double_d;
+  typedef detail::distance_helper<LNormNumber> distance_helper;
+  const unsigned int dimension = Query::dimension;
+
+  const double max_distance2 =
+      distance_helper::get_value_to_accumulate(max_distance);
+  const double_d domain_width =
+      query.get_bounds().bmax - query.get_bounds().bmin;
+
+  for (auto periodic = search_iterator<Query, LNormNumber>::get_periodic_range(
+           query.get_periodic(), query.get_bounds(), centre, max_distance);
+       periodic != false; ++periodic) {
+    const double_d point = centre + (*periodic) * domain_width;
+    for (auto bucket = query.template get_buckets_near_point<LNormNumber>(
+             point, max_distance);
+         bucket != false; ++bucket) {
+      for (auto p = query.get_bucket_particles(*bucket); p != false; ++p) {
+        const double_d dx = get<position>(*p) - point;
+        double accum = 0;
+        for (size_t i = 0; i < dimension; ++i) {
+          accum = distance_helper::accumulate_norm(accum, dx[i]);
+        }
+        if (!(accum > max_distance2)) {
+          f(*p, dx);
+        }
+      }
+    }
+  }
+}
+
+namespace detail {
+
+///
+/// @brief the search radius of target @p i for batch_distance_search(),
+/// where @p radius is either a constant radius or a function object
+///
+template <typename Radius>
+typename std::enable_if<std::is_arithmetic<Radius>::value, double>::type
+batch_search_radius(const Radius &radius, const size_t i) {
+  return radius;
+}
+
+template <typename Radius>
+typename std::enable_if<!std::is_arithmetic<Radius>::value, double>::type
+batch_search_radius(const Radius &radius, const size_t i) {
+  return radius(i);
+}
+
+} // namespace detail
+
+///
+/// @brief the neighbours of a set of target points, stored in compressed
+/// sparse row (CSR) format. This is returned by batch_distance_search()
+///
+/// @tparam Query the query object type
+///
+template <typename Query> struct batch_search_result {
+  typedef typename Query::double_d double_d;
+
+  ///
+  /// @brief the neighbours of target $i$ are stored from `offsets[i]` to
+  /// `offsets[i+1]-1` in #indices (and #dx). There are n+1 offsets for n
+  /// targets
+  ///
+  std::vector<size_t> offsets;
+
+  ///
+  /// @brief the index of each neighbouring particle in the particle set
+  ///
+  std::vector<size_t> indices;
+
+  ///
+  /// @brief the vector $r_b-r_a$ between each neighbouring particle $r_b$ and
+  /// (the periodic image of) its target point $r_a$. This is empty unless
+  /// requested
+  ///
+  std::vector<double_d> dx;
+};
+
+///
+/// @brief finds the particles within a given distance of each of a set of
+/// target points, and returns them as a @ref batch_search_result
+///
+/// This is equivalent to calling for_each_neighbour() for each target and
+/// appending the results, but avoids any per-target allocation. The targets
+/// are searched in parallel in two passes: the first counts the neighbours of
+/// each target, the counts are scanned to give the offsets of each target's
+/// neighbours, and the second pass fills in the neighbours. The neighbours of
+/// each target are in the same order as for_each_neighbour() finds them.
+/// Targets that are close together in space should also be close together in
+/// the target range (e.g. the positions of another ordered particle set), so
+/// that neighbouring targets search the same buckets.
+///
+/// Note that this function allocates its result and can only be called from
+/// host code
+///
+/// @tparam LNormNumber the norm to use (defaults to 2, the euclidean distance)
+/// @tparam Query the query object type
+/// @tparam TargetIterator a random access iterator to the target points
+/// @tparam Radius either a `double`, or a function object that takes the
+/// index of a target and returns its search radius
+/// @param query the query object
+/// @param targets_begin iterator to the first target point
+/// @param targets_end iterator to one past the last target point
+/// @param radius the maximum distance to search around each target
+/// @param store_dx if true, also store the vector between each target and its
+/// neighbours
+///
+template <int LNormNumber = 2, typename Query, typename TargetIterator,
+          typename Radius>
+batch_search_result<Query>
+batch_distance_search(const Query &query, TargetIterator targets_begin,
+                      TargetIterator targets_end, const Radius &radius,
+                      const bool store_dx = false) {
+  typedef typename Query::traits_type traits_type;
+  typedef typename traits_type::position position;
+  typedef typename Query::double_d double_d;
+  typedef typename Query::particle_iterator::reference reference;
+
+  const int n = targets_end - targets_begin;
+  batch_search_result<Query> result;
+  result.offsets.resize(n + 1, 0);
+  if (query.number_of_particles() == 0) {
+    return result;
+  }
+  const double_d *positions = &get<position>(query.get_particles_begin())[0];
+
+  // count the neighbours of each target
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < n; ++i) {
+    size_t count = 0;
+    for_each_neighbour<LNormNumber>(
+        query, targets_begin[i], detail::batch_search_radius(radius, i),
+        [&count](reference, const double_d &) { ++count; });
+    result.offsets[i + 1] = count;
+  }
+
+  detail::inclusive_scan(result.offsets.begin() + 1, result.offsets.end(),
+                         result.offsets.begin() + 1);
+
+  result.indices.resize(result.offsets[n]);
+  if (store_dx) {
+    result.dx.resize(result.offsets[n]);
+  }
+
+  // fill in the neighbours of each target
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < n; ++i) {
+    size_t k = result.offsets[i];
+    for_each_neighbour<LNormNumber>(
+        query, targets_begin[i], detail::batch_search_radius(radius, i),
+        [&](reference b, const double_d &dx) {
+          result.indices[k] = &get<position>(b) - positions;
+          if (store_dx) {
+            result.dx[k] = dx;
+          }
+          ++k;
+        });
+  }
+
+  return result;
+}
+
+namespace detail {
+
+///
+/// @brief recursive implementation of dual_tree_traversal() for a single
+/// pair of nodes
+///
+template <int LNormNumber, typename RowQuery, typename ColQuery, typename F>
+void dual_tree_traversal_impl(const RowQuery &row_query,
+                              const ColQuery &col_query,
+                              const typename RowQuery::child_iterator &ci_row,
+                              const typename ColQuery::child_iterator &ci_col,
+                              const typename RowQuery::double_d &offset,
+                              const double max_distance2, F &f) {
+  const unsigned int dimension = RowQuery::dimension;
+  const auto row_bounds = row_query.get_bounds(ci_row);
+  const auto col_bounds = col_query.get_bounds(ci_col);
+
+  // prune pairs of nodes that are further apart than the search distance
+  double accum = 0;
+  for (size_t i = 0; i < dimension; ++i) {
+    const double dist =
+        std::max(0.0, std::max(row_bounds.bmin[i] + offset[i] -
+                                   col_bounds.bmax[i],
+                               col_bounds.bmin[i] - row_bounds.bmax[i] -
+                                   offset[i]));
+    accum = distance_helper<LNormNumber>::accumulate_norm(accum, dist);
+  }
+  if (accum > max_distance2) {
+    return;
+  }
+
+  const bool row_is_leaf = row_query.is_leaf_node(*ci_row);
+  const bool col_is_leaf = col_query.is_leaf_node(*ci_col);
+  if (row_is_leaf && col_is_leaf) {
+    f(ci_row, ci_col, offset);
+    return;
+  }
+
+  // descend into the larger of the two nodes
+  const bool split_row =
+      col_is_leaf ||
+      (!row_is_leaf && (row_bounds.bmax - row_bounds.bmin).maxCoeff() >=
+                           (col_bounds.bmax - col_bounds.bmin).maxCoeff());
+  if (split_row) {
+    for (auto ci = row_query.get_children(ci_row); ci != false; ++ci) {
+      dual_tree_traversal_impl<LNormNumber>(row_query, col_query, ci, ci_col,
+                                            offset, max_distance2, f);
+    }
+  } else {
+    for (auto ci = col_query.get_children(ci_col); ci != false; ++ci) {
+      dual_tree_traversal_impl<LNormNumber>(row_query, col_query, ci_row, ci,
+                                            offset, max_distance2, f);
+    }
+  }
+}
+
+///
+/// @brief implementation of dual_tree_traversal() for a column query that is
+/// not a tree. The row tree is descended to its leaves, and each leaf is
+/// paired with the column buckets within @p max_distance of its bounding box
+///
+template <int LNormNumber, typename RowQuery, typename ColQuery, typename F>
+void dual_tree_traversal_buckets_impl(
+    const RowQuery &row_query, const ColQuery &col_query,
+    const typename RowQuery::child_iterator &ci_row,
+    const typename RowQuery::double_d &offset, const double max_distance,
+    const double max_distance2, F &f) {
+  typedef typename RowQuery::double_d double_d;
+
+  if (!row_query.is_leaf_node(*ci_row)) {
+    for (auto ci = row_query.get_children(ci_row); ci != false; ++ci) {
+      dual_tree_traversal_buckets_impl<LNormNumber>(
+          row_query, col_query, ci, offset, max_distance, max_distance2, f);
+    }
+    return;
+  }
+
+  // the column buckets within max_distance (in each dimension) of the box
+  // around the leaf, then prune these using the LNormNumber distance
+  const auto row_bounds = row_query.get_bounds(ci_row);
+  const double_d half_width = 0.5 * (row_bounds.bmax - row_bounds.bmin);
+  const double_d centre = 0.5 * (row_bounds.bmin + row_bounds.bmax) + offset;
+  for (auto bucket = col_query.template get_buckets_near_point<-1>(
+           centre, half_width + max_distance);
+       bucket != false; ++bucket) {
+    dual_tree_traversal_impl<LNormNumber>(row_query, col_query, ci_row,
+                                          bucket.get_child_iterator(), offset,
+                                          max_distance2, f);
+  }
+}
+
+} // namespace detail
+
+///
+/// @brief calls a function for every pair of leaf nodes, one from each of two
+/// spatial data structures, that are within a given distance of each other
+///
+/// The two trees are descended together, starting from their root nodes. A
+/// pair of nodes is pruned if their bounding boxes are further apart than
+/// @p max_distance, otherwise the larger of the two nodes is split into its
+/// children. When both nodes are leaves, @p f is called with the pair. This
+/// visits far fewer nodes than searching the column tree separately for each
+/// row particle when both sets are large and spatially coherent.
+///
+/// This is intended for trees (e.g. Kdtree or HyperOctree), but works for any
+/// query type. If the column data structure is not a tree (e.g. a cell list),
+/// each leaf node of the row data structure is instead paired with the column
+/// buckets near it, found using `get_buckets_near_point()`.
+///
+/// If the column data structure is periodic, each periodic image of the row
+/// data structure is traversed in turn. Note that a pair of leaf nodes is not
+/// guaranteed to contain any particles within @p max_distance of each other,
+/// so @p f still needs to check the distance between the particles
+///
+/// @tparam LNormNumber the norm to use (defaults to 2, the euclidean distance)
+/// @tparam RowQuery the query object type of the row particles
+/// @tparam ColQuery the query object type of the column particles
+/// @tparam F function object type
+/// @param row_query the query object of the row particles
+/// @param col_query the query object of the column particles
+/// @param max_distance the maximum distance between particles
+/// @param f function object called as `f(ci_row, ci_col, offset)`, where
+/// `ci_row` and `ci_col` are child iterators to the two leaf nodes (use
+/// `get_bucket_particles(*ci_row)` to get their particles), and `offset` is the
+/// periodic shift that should be added to the positions of the row particles
+///
+template <int LNormNumber = 2, typename RowQuery, typename ColQuery,
+          typename F>
+void dual_tree_traversal(const RowQuery &row_query, const ColQuery &col_query,
+                         const double max_distance, F f) {
+  typedef typename RowQuery::double_d double_d;
+  typedef typename RowQuery::int_d int_d;
+  const unsigned int dimension = RowQuery::dimension;
+  static_assert(dimension == ColQuery::dimension,
+                "row and column particles must have the same dimension");
+
+  if (row_query.number_of_particles() == 0 ||
+      col_query.number_of_particles() == 0) {
+    return;
+  }
+
+  const double max_distance2 =
+      detail::distance_helper<LNormNumber>::get_value_to_accumulate(
+          max_distance);
+  const auto &col_bounds = col_query.get_bounds();
+  const double_d domain_width = col_bounds.bmax - col_bounds.bmin;
+  int_d start, end;
+  for (size_t i = 0; i < dimension; ++i) {
+    start[i] = col_query.get_periodic()[i] ? -1 : 0;
+    end[i] = col_query.get_periodic()[i] ? 2 : 1;
+  }
+
+  for (auto periodic = lattice_iterator<dimension>(start, end);
+       periodic != false; ++periodic) {
+    const double_d offset = (*periodic) * domain_width;
+    for (auto ci_row = row_query.get_children(); ci_row != false; ++ci_row) {
+      if (!col_query.is_tree()) {
+        detail::dual_tree_traversal_buckets_impl<LNormNumber>(
+            row_query, col_query, ci_row, offset, max_distance, max_distance2,
+            f);
+        continue;
+      }
+      for (auto ci_col = col_query.get_children(); ci_col != false;
+           ++ci_col) {
+        detail::dual_tree_traversal_impl<LNormNumber>(
+            row_query, col_query, ci_row, ci_col, offset, max_distance2, f);
+      }
+    }
+  }
+}
+
+///
+/// @brief a single neighbour returned by knn_search()
+///
+/// @tparam Query the query object type
+///
+template <typename Query> struct knn_neighbour {
+  typedef typename Query::raw_pointer pointer;
+  typedef typename Query::double_d double_d;
+
+  ///
+  /// @brief pointer to the neighbouring particle
+  ///
+  pointer particle;
+
+  ///
+  /// @brief the shortest (taking into account periodicity) vector $r_b-r_a$
+  /// between the search point $r_a$ and the neighbouring particle $r_b$
+  ///
+  double_d dx;
+
+  ///
+  /// @brief the euclidean distance between the search point and the
+  /// neighbouring particle
+  ///
+  double distance;
+};
+
+///
+/// @brief returns the @p k nearest particles to a point, sorted by increasing
+/// euclidean distance
+///
+/// The search starts with a radius that would on average contain @p k
+/// particles, and doubles this radius until @p k particles are found within
+/// it. During each search the current @p k best candidates are held in a
+/// bounded max-heap, and any bucket that is further away than the current
+/// k-th candidate is skipped. For periodic domains only the closest periodic
+/// image of each particle is considered, so each particle is returned at most
+/// once. If there are less than @p k particles in the container, all of them
+/// are returned.
+///
+/// Note that unlike distance_search(), this function allocates its result and
+/// can only be called from host code
+///
+/// @tparam Query the query object type
+/// @param query the query object
+/// @param centre the central point of the search
+/// @param k the number of neighbours to find
+/// @return a vector of @ref knn_neighbour, sorted by distance
+///
+template <typename Query>
+std::vector<knn_neighbour<Query>>
+knn_search(const Query &query, const typename Query::double_d &centre,
+           const size_t k) {
+  typedef typename Query::traits_type traits_type;
+  typedef typename traits_type::position position;
+  typedef typename Query::double_d double_d;
+  typedef typename Query::bool_d bool_d;
+  typedef typename Query::int_d int_d;
+  typedef std::tuple<double, size_t, double_d> candidate_type;
+  const unsigned int dimension = Query::dimension;
+
+  std::vector<knn_neighbour<Query>> neighbours;
+  const size_t n = query.number_of_particles();
+  if (k == 0 || n == 0) {
+    return neighbours;
+  }
+
+  const auto &bounds = query.get_bounds();
+  const bool_d &periodic = query.get_periodic();
+  const double_d domain_width = bounds.bmax - bounds.bmin;
+  const double_d *positions = &get<position>(query.get_particles_begin())[0];
+
+  // the search radius that is guarenteed to contain every particle (or its
+  // closest periodic image)
+  double max_radius2 = 0;
+  int_d image_start, image_end;
+  for (size_t d = 0; d < dimension; ++d) {
+    const double furthest =
+        periodic[d] ? 0.5 * domain_width[d]
+                    : std::max(std::abs(centre[d] - bounds.bmin[d]),
+                               std::abs(centre[d] - bounds.bmax[d]));
+    max_radius2 += furthest * furthest;
+    image_start[d] = periodic[d] ? -1 : 0;
+    image_end[d] = periodic[d] ? 2 : 1;
+  }
+  const double max_radius = std::sqrt(max_radius2);
+
+  // start with a cube that on average contains k particles
+  double radius =
+      std::pow(static_cast<double>(k) / n * domain_width.prod(), 1.0 / dimension);
+
+  auto compare_candidates = [](const candidate_type &a,
+                               const candidate_type &b) {
+    return std::get<0>(a) < std::get<0>(b);
+  };
+  std::vector<candidate_type> heap;
+  heap.reserve(k);
+
+  bool finished = false;
+  while (!finished) {
+    const bool search_everything = radius >= max_radius;
+    if (search_everything) {
+      radius = 1.01 * max_radius;
+    }
+    LOG(3, "knn_search: searching around " << centre << " with radius "
+                                           << radius);
+    heap.clear();
+    for (lattice_iterator<dimension> image(image_start, image_end);
+         image != false; ++image) {
+      const double_d image_centre = centre + (*image) * domain_width;
+      for (auto bucket =
+               query.template get_buckets_near_point<2>(image_centre, radius);
+           bucket != false; ++bucket) {
+
+        // skip buckets further away than the current k-th candidate
+        if (heap.size() == k) {
+          const auto bucket_bounds = query.get_bounds(bucket.get_child_iterator());
+          double accum = 0;
+          for (size_t d = 0; d < dimension; ++d) {
+            const double dist =
+                std::max(0.0, std::max(bucket_bounds.bmin[d] - image_centre[d],
+                                       image_centre[d] - bucket_bounds.bmax[d]));
+            accum += dist * dist;
+          }
+          if (accum > std::get<0>(heap.front())) {
+            continue;
+          }
+        }
+
+        for (auto p = query.get_bucket_particles(*bucket); p != false; ++p) {
+          const double_d &pi = get<position>(*p);
+          const double_d dx = pi - image_centre;
+
+          // only consider the closest periodic image of each particle
+          bool closest_image = true;
+          for (size_t d = 0; d < dimension; ++d) {
+            if (periodic[d] && (dx[d] > 0.5 * domain_width[d] ||
+                                dx[d] <= -0.5 * domain_width[d])) {
+              closest_image = false;
+            }
+          }
+          if (!closest_image) {
+            continue;
+          }
+
+          const double dx2 = dx.squaredNorm();
+          if (heap.size() < k) {
+            heap.emplace_back(dx2, &pi - positions, dx);
+            std::push_heap(heap.begin(), heap.end(), compare_candidates);
+          } else if (dx2 < std::get<0>(heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), compare_candidates);
+            heap.back() = candidate_type(dx2, &pi - positions, dx);
+            std::push_heap(heap.begin(), heap.end(), compare_candidates);
+          }
+        }
+      }
+    }
+
+    // finished if every particle outside the searched buckets is guarenteed
+    // to be further away than the k-th candidate
+    finished = search_everything ||
+               (heap.size() == k && std::get<0>(heap.front()) <= radius * radius);
+    radius *= 2;
+  }
+
+  std::sort_heap(heap.begin(), heap.end(), compare_candidates);
+  neighbours.resize(heap.size());
+  for (size_t i = 0; i < heap.size(); ++i) {
+    neighbours[i].particle = query.get_particles_begin() + std::get<1>(heap[i]);
+    neighbours[i].dx = std::get<2>(heap[i]);
+    neighbours[i].distance = std::sqrt(std::get<0>(heap[i]));
+  }
+  return neighbours;
+}
+
 ///
 /// @brief returns a @ref bucket_pair_iterator that iterates through all the
 /// neighbouring buckets (i.e. buckets that are touching) within a domain. Note
@@ -852,6 +1418,213 @@ CUDA_HOST_DEVICE Iterator get_neighbouring_buckets(const Query &query) {
   return Iterator(query);
 }
 
+namespace detail {
+
+///
+/// @brief calls @p f for every pair of particles within a distance
+/// sqrt(@p radius2) that have the first particle in @p bucket, and the second
+/// particle either later in @p bucket or in the "forward" half of the
+/// neighbouring buckets (i.e. buckets whose offset from @p bucket has a
+/// positive first non-zero component)
+///
+template <typename Query, typename F>
+void for_each_neighbour_pair_in_bucket(const Query &query,
+                                       const typename Query::int_d &bucket,
+                                       const double radius2, F &f) {
+  typedef typename Query::traits_type traits_type;
+  typedef typename traits_type::position position;
+  typedef typename Query::double_d double_d;
+  typedef typename Query::int_d int_d;
+  const unsigned int dimension = Query::dimension;
+
+  const int_d &end_bucket = query.get_end_bucket();
+  const double_d domain_width =
+      query.get_bounds().bmax - query.get_bounds().bmin;
+
+  // pairs within the bucket
+  for (auto pi = query.get_bucket_particles(bucket); pi != false; ++pi) {
+    const double_d &ri = get<position>(*pi);
+    auto pj = pi;
+    for (++pj; pj != false; ++pj) {
+      const double_d dx = get<position>(*pj) - ri;
+      if (dx.squaredNorm() < radius2) {
+        f(*pi, *pj, dx);
+      }
+    }
+  }
+
+  // pairs with the forward half of the neighbouring buckets
+  for (lattice_iterator<dimension> offset(int_d::Constant(-1),
+                                          int_d::Constant(2));
+       offset != false; ++offset) {
+    const int_d &o = *offset;
+    int first_non_zero = 0;
+    for (size_t d = 0; d < dimension && first_non_zero == 0; ++d) {
+      first_non_zero = o[d];
+    }
+    if (first_non_zero <= 0) {
+      continue;
+    }
+
+    int_d other = bucket + o;
+    double_d shift = double_d::Constant(0);
+    bool valid = true;
+    for (size_t d = 0; d < dimension; ++d) {
+      if (other[d] < 0 || other[d] > end_bucket[d]) {
+        if (query.get_periodic()[d]) {
+          const int sign = other[d] < 0 ? -1 : 1;
+          other[d] -= sign * (end_bucket[d] + 1);
+          shift[d] = sign * domain_width[d];
+        } else {
+          valid = false;
+        }
+      }
+    }
+    if (!valid) {
+      continue;
+    }
+
+    for (auto pi = query.get_bucket_particles(bucket); pi != false; ++pi) {
+      const double_d ri = get<position>(*pi) - shift;
+      for (auto pj = query.get_bucket_particles(other); pj != false; ++pj) {
+        const double_d dx = get<position>(*pj) - ri;
+        if (dx.squaredNorm() < radius2) {
+          f(*pi, *pj, dx);
+        }
+      }
+    }
+  }
+}
+
+template <typename Query>
+void check_neighbour_pair_radius(const Query &query, const double radius) {
+  typedef typename Query::double_d double_d;
+  const double_d bucket_side_length =
+      (query.get_bounds().bmax - query.get_bounds().bmin) /
+      (query.get_end_bucket() + 1).template cast<double>();
+  CHECK((bucket_side_length >= radius).all(),
+        "neighbour pair search requires a bucket side length ("
+            << bucket_side_length << ") of at least the search radius ("
+            << radius
+            << "). Try increasing n_particles_in_leaf in "
+               "init_neighbour_search");
+  for (size_t d = 0; d < Query::dimension; ++d) {
+    CHECK(!query.get_periodic()[d] || query.get_end_bucket()[d] > 0,
+          "neighbour pair search requires at least two buckets along "
+          "each periodic dimension");
+  }
+}
+
+} // namespace detail
+
+///
+/// @brief calls a function for every unordered pair of particles that are
+/// within a given euclidean distance of each other
+///
+/// Each pair is visited exactly once, so @p f can apply equal and opposite
+/// updates to both particles (e.g. pair forces using Newton's third law),
+/// halving the number of distance evaluations compared with a
+/// euclidean_search() around every particle. Only pairs of touching buckets
+/// are searched, so this requires a cell list query (@ref CellListQuery or
+/// @ref CellListOrderedQuery) with a bucket side length of at least
+/// @p radius in every dimension. For periodic domains the pairs are formed
+/// between periodic images, so if @p radius is less than half the domain
+/// width @p dx is the minimum image separation.
+///
+/// @tparam Query the query object type
+/// @tparam F function object type
+/// @param query the query object
+/// @param radius the maximum euclidean distance between particle pairs
+/// @param f function object called as `f(a, b, dx)`, where `a` and `b` are
+/// references to the two particles and `dx` is the vector $r_b-r_a$
+/// @see for_each_neighbour_pair_parallel()
+///
+template <typename Query, typename F>
+void for_each_neighbour_pair(const Query &query, const double radius, F f) {
+  typedef typename Query::int_d int_d;
+  const unsigned int dimension = Query::dimension;
+  detail::check_neighbour_pair_radius(query, radius);
+  const double radius2 = radius * radius;
+  for (lattice_iterator<dimension> bucket(int_d::Constant(0),
+                                          query.get_end_bucket() + 1);
+       bucket != false; ++bucket) {
+    detail::for_each_neighbour_pair_in_bucket(query, *bucket, radius2, f);
+  }
+}
+
+///
+/// @brief a parallel version of for_each_neighbour_pair()
+///
+/// The buckets are coloured such that any two buckets of the same colour are
+/// at least three buckets apart in some dimension. The pairs found from each
+/// bucket only involve that bucket and its touching neighbours, so all the
+/// buckets of a single colour can be processed concurrently without any two
+/// threads calling @p f with the same particle. The colours are processed in
+/// turn (3^D colours, or slightly more for periodic dimensions that are not a
+/// multiple of 3 buckets wide).
+///
+/// @p f must be safe to call concurrently for pairs of different particles,
+/// i.e. it should only write to the two particles it is given. If HAVE_OPENMP
+/// is not defined this is the same as for_each_neighbour_pair()
+///
+/// @tparam Query the query object type
+/// @tparam F function object type
+/// @param query the query object
+/// @param radius the maximum euclidean distance between particle pairs
+/// @param f function object called as `f(a, b, dx)`, where `a` and `b` are
+/// references to the two particles and `dx` is the vector $r_b-r_a$
+///
+template <typename Query, typename F>
+void for_each_neighbour_pair_parallel(const Query &query, const double radius,
+                                      F f) {
+  typedef typename Query::int_d int_d;
+  const unsigned int dimension = Query::dimension;
+  detail::check_neighbour_pair_radius(query, radius);
+  const double radius2 = radius * radius;
+
+  // the buckets of each colour, for each dimension. Colours 0-2 are the
+  // buckets with index modulo 3, except that for a periodic dimension whose
+  // width is not a multiple of 3 the last (1 or 2) buckets get their own
+  // colour, so that wrapping around never brings buckets of the same colour
+  // within 3 of each other
+  const int_d &end_bucket = query.get_end_bucket();
+  int_d num_colours;
+  std::vector<std::vector<int>> colour_buckets[dimension];
+  for (size_t d = 0; d < dimension; ++d) {
+    const int n = end_bucket[d] + 1;
+    const int remainder = query.get_periodic()[d] ? n % 3 : 0;
+    const int n_regular = n - remainder;
+    num_colours[d] = 3 + remainder;
+    colour_buckets[d].resize(num_colours[d]);
+    for (int i = 0; i < n; ++i) {
+      const int colour = i < n_regular ? i % 3 : 3 + i - n_regular;
+      colour_buckets[d][colour].push_back(i);
+    }
+  }
+
+  for (lattice_iterator<dimension> colour(int_d::Constant(0), num_colours);
+       colour != false; ++colour) {
+    int_d size;
+    for (size_t d = 0; d < dimension; ++d) {
+      size[d] = colour_buckets[d][(*colour)[d]].size();
+    }
+    const int n = size.prod();
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int k = 0; k < n; ++k) {
+      int_d bucket;
+      int index = k;
+      for (int d = dimension - 1; d >= 0; --d) {
+        bucket[d] = colour_buckets[d][(*colour)[d]][index % size[d]];
+        index /= size[d];
+      }
+      detail::for_each_neighbour_pair_in_bucket(query, bucket, radius2, f);
+    }
+  }
+}
+
 } // namespace Aboria
 
 #endif
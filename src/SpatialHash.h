@@ -0,0 +1,885 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef SPATIAL_HASH_H_
+#define SPATIAL_HASH_H_
+
+#include "CudaInclude.h"
+#include "Get.h"
+#include "NeighbourSearchBase.h"
+#include "SpatialUtil.h"
+#include "Traits.h"
+#include "Vector.h"
+#include "detail/Algorithms.h"
+
+#include "Log.h"
+#include <cstdint>
+#include <iostream>
+
+namespace Aboria {
+
+template <typename Traits> struct SpatialHashQuery;
+
+/// @brief A hashed cell list spatial data structure that is paired with a
+/// SpatialHashQuery query type
+///
+/// This class implements neighbourhood searching using a regular grid of
+/// constant size "buckets", like CellListOrdered. The difference is that the
+/// grid is not fixed to the domain given to Particles::init_neighbour_search.
+/// Instead, every update covers the bounding box of the particles with a
+/// (virtual) grid, and only the buckets that contain particles are stored, in
+/// an open-addressing hash table keyed by the bucket. Memory use therefore
+/// scales with the number of particles rather than with the volume of the
+/// domain.
+///
+/// The bucket side length is refined on every update until the occupied
+/// buckets hold about n_particles_in_leaf particles on average, so particles
+/// in small clusters far apart still get small buckets.
+///
+/// SpatialHash does not need any domain bounds, so it can be used for open
+/// boundary problems where the particles spread out without limit (use
+/// Particles::init_neighbour_search(const double)). It does not support
+/// periodic domains.
+///
+/// The particle set is reordered by bucket, so particles within a given bucket
+/// are sequential in memory. The hash table itself is built on the host.
+///
+template <typename Traits>
+class SpatialHash : public neighbour_search_base<SpatialHash<Traits>, Traits,
+                                                 SpatialHashQuery<Traits>> {
+
+  typedef typename Traits::double_d double_d;
+  typedef typename Traits::int_d int_d;
+  typedef typename Traits::position position;
+  typedef typename Traits::vector_unsigned_int vector_unsigned_int;
+  typedef typename Traits::vector_int_d vector_int_d;
+  typedef typename Traits::vector_size_t vector_size_t;
+  typedef typename Traits::unsigned_int_d unsigned_int_d;
+  typedef typename Traits::iterator iterator;
+  static const unsigned int dimension = Traits::dimension;
+
+  typedef neighbour_search_base<SpatialHash<Traits>, Traits,
+                                SpatialHashQuery<Traits>>
+      base_type;
+
+  friend base_type;
+
+public:
+  SpatialHash()
+      : base_type(), m_bucket_side_length(double_d::Constant(0)) {}
+
+  static constexpr bool ordered() { return true; }
+
+  static constexpr bool unbounded() { return true; }
+
+  void print_data_structure() const {
+#ifndef __CUDA_ARCH__
+    LOG(1, "\tgrid: bounds = " << m_query.m_bounds
+                               << " side length = " << m_bucket_side_length
+                               << " size = " << m_size);
+    LOG(1, "\thash table:");
+    for (size_t i = 0; i < m_table_buckets.size(); ++i) {
+      if (m_table_end[i] != 0) {
+        LOG(1, "\ti = " << i << " bucket = " << m_table_buckets[i]
+                        << " bucket contents = " << m_table_begin[i] << " to "
+                        << m_table_end[i]);
+      }
+    }
+    LOG(1, "\tend hash table");
+    LOG(1, "\tparticles:");
+    for (size_t i = 0; i < m_bucket_keys.size(); ++i) {
+      LOG(1, "\ti = " << i << " p = "
+                      << static_cast<const double_d &>(
+                             get<position>(*(this->m_particles_begin + i)))
+                      << " bucket key = " << m_bucket_keys[i]);
+    }
+    LOG(1, "\tend particles:");
+#endif
+  }
+
+  ///
+  /// @brief function object to transform a point to the key of its bucket,
+  /// clamping the bucket to the grid
+  ///
+  struct point_to_bucket_key_lambda {
+    detail::point_to_bucket_index<dimension> m_point_to_bucket_index;
+    int_d m_end_bucket;
+
+    point_to_bucket_key_lambda(
+        const detail::point_to_bucket_index<dimension> &point_to_bucket_index,
+        const int_d &end_bucket)
+        : m_point_to_bucket_index(point_to_bucket_index),
+          m_end_bucket(end_bucket) {}
+
+    CUDA_HOST_DEVICE
+    int_d get_bucket(const double_d &p) const {
+      int_d index = m_point_to_bucket_index.find_bucket_index_vector(p);
+      for (size_t i = 0; i < dimension; ++i) {
+        if (index[i] < 0) {
+          index[i] = 0;
+        } else if (index[i] > m_end_bucket[i]) {
+          index[i] = m_end_bucket[i];
+        }
+      }
+      return index;
+    }
+
+    CUDA_HOST_DEVICE
+    size_t operator()(const double_d &p) const {
+      return SpatialHashQuery<Traits>::bucket_key(get_bucket(p));
+    }
+  };
+
+private:
+  void set_domain_impl() {
+    CHECK(!this->m_periodic.any(),
+          "SpatialHash does not support periodic domains");
+    this->m_query.m_periodic = this->m_periodic;
+  }
+
+  void update_iterator_impl() {}
+
+  void update_positions_impl(iterator update_begin, iterator update_end,
+                             const int new_n,
+                             const bool call_set_domain = true) {
+
+    ASSERT(update_begin == this->m_particles_begin &&
+               update_end == this->m_particles_end,
+           "error should be update all");
+
+    const size_t n = this->m_alive_indices.size();
+    auto positions = Traits::make_permutation_iterator(
+        get<position>(this->m_particles_begin), this->m_alive_indices.begin());
+
+    // cover the particles with the grid
+    typedef bbox<dimension> box_type;
+    const box_type bounds =
+        n > 0 ? detail::reduce(positions, positions + n, box_type(),
+                               [](box_type a, const box_type &b) {
+                                 return a + b;
+                               })
+              : box_type(double_d::Constant(0));
+    calculate_grid(bounds, positions, n);
+
+    m_bucket_keys.resize(n);
+    if (n > 0) {
+      // transform the points to their bucket keys and sort them
+      detail::transform(positions, positions + n, m_bucket_keys.begin(),
+                        point_to_bucket_key_lambda(m_point_to_bucket_index,
+                                                   m_query.m_end_bucket));
+
+      detail::sort_by_key(m_bucket_keys.begin(), m_bucket_keys.end(),
+                          this->m_alive_indices.begin());
+    }
+
+    build_hash_table(positions);
+
+#ifndef __CUDA_ARCH__
+    if (4 <= ABORIA_LOG_LEVEL) {
+      print_data_structure();
+    }
+#endif
+  }
+
+  ///
+  /// @brief sets up a grid with bucket side length @p side covering @p bounds
+  ///
+  void set_grid(const bbox<dimension> &bounds, const double side) {
+    const double_d extent = bounds.bmax - bounds.bmin;
+    for (size_t i = 0; i < dimension; ++i) {
+      m_size[i] = static_cast<unsigned int>(std::floor(extent[i] / side)) + 1;
+      // make sure rounding does not put the upper bound on the grid boundary
+      if (!(m_size[i] * side > extent[i])) {
+        ++m_size[i];
+      }
+    }
+    m_bucket_side_length = double_d::Constant(side);
+    const bbox<dimension> grid_bounds(
+        bounds.bmin, bounds.bmin + m_bucket_side_length * m_size);
+    m_point_to_bucket_index = detail::point_to_bucket_index<dimension>(
+        m_size, m_bucket_side_length, grid_bounds);
+
+    m_query.m_bucket_side_length = m_bucket_side_length;
+    m_query.m_bounds = grid_bounds;
+    m_query.m_end_bucket = m_size - 1;
+    m_query.m_point_to_bucket_index = m_point_to_bucket_index;
+  }
+
+  ///
+  /// @brief the occupancy of a grid, see calculate_occupancy()
+  ///
+  struct grid_occupancy {
+    /// the number of buckets that contain at least one particle
+    size_t occupied_buckets;
+    /// the largest extent of the particles within any bucket holding more
+    /// than the given number of particles
+    double max_overfull_extent;
+  };
+
+  ///
+  /// @brief returns the occupancy of the current grid by the @p n particles
+  /// at @p positions, where buckets with more than @p max_particles
+  /// particles are overfull
+  ///
+  template <typename PositionIterator>
+  grid_occupancy calculate_occupancy(PositionIterator positions,
+                                     const size_t n,
+                                     const double max_particles) const {
+    const point_to_bucket_key_lambda to_key(m_point_to_bucket_index,
+                                            m_query.m_end_bucket);
+
+    // insert each key into an open-addressing set, keeping it at most half
+    // full, and find the count and bounding box of the particles with each
+    // key. Distinct buckets with equal keys are counted once, which only
+    // happens for very large grids (see SpatialHashQuery::bucket_key())
+    const int bits = std::max(1, detail::bits_to_represent(2 * n));
+    const size_t table_size = size_t(1) << bits;
+    std::vector<size_t> keys(table_size);
+    std::vector<size_t> counts(table_size, 0);
+    std::vector<bbox<dimension>> bounds(table_size);
+    grid_occupancy occupancy = {0, 0};
+    for (size_t i = 0; i < n; ++i) {
+      const double_d &p = *(positions + i);
+      const size_t key = to_key(p);
+      size_t slot = SpatialHashQuery<Traits>::hash_bucket_key(key, bits);
+      while (counts[slot] != 0 && keys[slot] != key) {
+        slot = (slot + 1) & (table_size - 1);
+      }
+      if (counts[slot] == 0) {
+        keys[slot] = key;
+        bounds[slot] = bbox<dimension>(p);
+        ++occupancy.occupied_buckets;
+      } else {
+        bounds[slot] = bounds[slot] + bbox<dimension>(p);
+      }
+      ++counts[slot];
+    }
+    for (size_t slot = 0; slot < table_size; ++slot) {
+      if (counts[slot] > max_particles) {
+        occupancy.max_overfull_extent =
+            std::max(occupancy.max_overfull_extent,
+                     (bounds[slot].bmax - bounds[slot].bmin).maxCoeff());
+      }
+    }
+    return occupancy;
+  }
+
+  ///
+  /// @brief sets up a grid covering @p bounds, with buckets sized so that
+  /// the occupied buckets hold about #m_n_particles_in_leaf particles on
+  /// average
+  ///
+  /// Starting from the side length of the last update (or an estimate from
+  /// the volume of @p bounds), the side length is refined using the mean
+  /// occupancy of the occupied buckets, so particles that are clustered
+  /// within a much larger bounding box still get small buckets. Normally the
+  /// side length of the last update is accepted after a single pass over the
+  /// particles
+  ///
+  template <typename PositionIterator>
+  void calculate_grid(const bbox<dimension> &bounds,
+                      PositionIterator positions, const size_t n) {
+    const double_d extent = bounds.bmax - bounds.bmin;
+    const double max_extent = extent.maxCoeff();
+    const double n_leaf = this->m_n_particles_in_leaf;
+
+    if (n <= n_leaf || !(max_extent > 0)) {
+      set_grid(bounds, max_extent > 0 ? max_extent : 1.0);
+    } else {
+      // the bucket indices must fit in an int
+      const double min_side = max_extent / (1 << 30);
+
+      double side = m_bucket_side_length[0];
+      if (!(side > 0)) {
+        // estimate from the volume of the bounding box. The particles might
+        // lie on a line or plane, so dimensions that are thinner than a
+        // bucket count as one bucket thick. This gives a fixed point
+        // iteration for the side length, which converges quickly
+        side = max_extent;
+        for (int iter = 0; iter < 20; ++iter) {
+          double volume = 1;
+          for (size_t i = 0; i < dimension; ++i) {
+            volume *= std::max(extent[i], side);
+          }
+          side = std::pow(n_leaf / n * volume, 1.0 / dimension);
+        }
+      }
+
+      bool was_too_large = false;
+      for (int iter = 0; iter < 32; ++iter) {
+        side = std::min(std::max(side, min_side), max_extent);
+        set_grid(bounds, side);
+        const grid_occupancy occupancy =
+            calculate_occupancy(positions, n, 2 * n_leaf);
+        const double mean = double(n) / occupancy.occupied_buckets;
+        LOG(3, "SpatialHash: side length = " << side
+                                             << " mean occupancy = " << mean);
+        if (mean > 2 * n_leaf) {
+          // stop refining if smaller buckets cannot split the overfull
+          // buckets, e.g. if many particles have the same position
+          if (side == min_side || !(occupancy.max_overfull_extent > 0)) {
+            break;
+          }
+          was_too_large = true;
+          // no larger than the particles in the overfull buckets
+          const double factor = std::pow(n_leaf / mean, 1.0 / dimension);
+          side = std::min(side * std::max(factor, 0.1),
+                          occupancy.max_overfull_extent);
+        } else if (mean >= 0.5 * n_leaf || side == max_extent ||
+                   was_too_large) {
+          // accept, preferring buckets that are too small over oscillating
+          break;
+        } else {
+          const double factor = std::pow(n_leaf / mean, 1.0 / dimension);
+          side *= std::min(factor, 10.0);
+        }
+      }
+    }
+
+    LOG(2, "SpatialHash: grid bounds = " << m_query.m_bounds);
+    LOG(2, "\tbucket side length = " << m_bucket_side_length[0]);
+    LOG(2, "\tnumber of buckets = " << m_size);
+  }
+
+  ///
+  /// @brief inserts the range of particles in each occupied bucket into the
+  /// hash table, using linear probing. The table is kept at most half full
+  ///
+  /// The particles have been sorted by bucket key. For very large grids
+  /// distinct buckets can share a key, so in that case each run of equal
+  /// keys is also sorted by bucket
+  ///
+  template <typename PositionIterator>
+  void build_hash_table(PositionIterator positions) {
+    const size_t n = m_bucket_keys.size();
+    const point_to_bucket_key_lambda to_key(m_point_to_bucket_index,
+                                            m_query.m_end_bucket);
+
+    bool exact_keys = true;
+    for (size_t i = 0; i < dimension; ++i) {
+      if (m_size[i] - 1 > SpatialHashQuery<Traits>::bucket_key_mask) {
+        exact_keys = false;
+      }
+    }
+
+    m_bucket_starts.clear();
+    m_start_buckets.clear();
+    for (size_t i = 0; i < n;) {
+      size_t end = i + 1;
+      while (end < n && m_bucket_keys[end] == m_bucket_keys[i]) {
+        ++end;
+      }
+      if (exact_keys) {
+        m_bucket_starts.push_back(i);
+        m_start_buckets.push_back(to_key.get_bucket(*(positions + i)));
+      } else {
+        std::vector<std::pair<int_d, int>> run(end - i);
+        for (size_t j = i; j < end; ++j) {
+          run[j - i] = std::make_pair(to_key.get_bucket(*(positions + j)),
+                                      int(this->m_alive_indices[j]));
+        }
+        std::stable_sort(run.begin(), run.end(),
+                         [](const std::pair<int_d, int> &a,
+                            const std::pair<int_d, int> &b) {
+                           for (size_t d = 0; d < dimension; ++d) {
+                             if (a.first[d] != b.first[d]) {
+                               return a.first[d] < b.first[d];
+                             }
+                           }
+                           return false;
+                         });
+        for (size_t j = i; j < end; ++j) {
+          this->m_alive_indices[j] = run[j - i].second;
+          if (j == i || (run[j - i].first != run[j - i - 1].first).any()) {
+            m_bucket_starts.push_back(j);
+            m_start_buckets.push_back(run[j - i].first);
+          }
+        }
+      }
+      i = end;
+    }
+    const size_t nbuckets = m_bucket_starts.size();
+
+    const int bits = std::max(1, detail::bits_to_represent(2 * nbuckets));
+    const size_t table_size = size_t(1) << bits;
+    m_query.m_table_bits = bits;
+    m_table_buckets.resize(table_size);
+    m_table_begin.assign(table_size, 0);
+    m_table_end.assign(table_size, 0);
+
+    for (size_t b = 0; b < nbuckets; ++b) {
+      const int_d &bucket = m_start_buckets[b];
+      size_t slot = SpatialHashQuery<Traits>::hash_bucket_key(
+          SpatialHashQuery<Traits>::bucket_key(bucket), bits);
+      while (m_table_end[slot] != 0) {
+        slot = (slot + 1) & (table_size - 1);
+      }
+      m_table_buckets[slot] = bucket;
+      m_table_begin[slot] = m_bucket_starts[b];
+      m_table_end[slot] = b + 1 < nbuckets ? m_bucket_starts[b + 1] : n;
+    }
+
+    LOG(2, "SpatialHash: " << nbuckets << " occupied buckets in a table of "
+                           << table_size);
+
+    m_query.m_table_buckets = iterator_to_raw_pointer(m_table_buckets.begin());
+    m_query.m_table_begin = iterator_to_raw_pointer(m_table_begin.begin());
+    m_query.m_table_end = iterator_to_raw_pointer(m_table_end.begin());
+  }
+
+  const SpatialHashQuery<Traits> &get_query_impl() const { return m_query; }
+
+  SpatialHashQuery<Traits> &get_query_impl() { return m_query; }
+
+  // the hash table stores the bucket of each occupied bucket, along with the
+  // range of particles in that bucket, [begin, end). Empty slots have end = 0
+  vector_int_d m_table_buckets;
+  vector_unsigned_int m_table_begin;
+  vector_unsigned_int m_table_end;
+  vector_size_t m_bucket_keys;
+  std::vector<unsigned int> m_bucket_starts;
+  std::vector<int_d> m_start_buckets;
+  SpatialHashQuery<Traits> m_query;
+
+  double_d m_bucket_side_length;
+  unsigned_int_d m_size;
+  detail::point_to_bucket_index<dimension> m_point_to_bucket_index;
+};
+
+/// @copydetails NeighbourQueryBase
+///
+/// @brief This is a query object for the SpatialHash spatial data structure
+///
+template <typename Traits>
+struct SpatialHashQuery : public NeighbourQueryBase<Traits> {
+
+  typedef Traits traits_type;
+  typedef typename Traits::raw_pointer raw_pointer;
+  typedef typename Traits::double_d double_d;
+  typedef typename Traits::bool_d bool_d;
+  typedef typename Traits::int_d int_d;
+  typedef typename Traits::unsigned_int_d unsigned_int_d;
+  const static unsigned int dimension = Traits::dimension;
+  template <int LNormNumber>
+  using query_iterator =
+      lattice_iterator_within_distance<SpatialHashQuery, LNormNumber>;
+  typedef lattice_iterator<dimension> all_iterator;
+  typedef lattice_iterator<dimension> child_iterator;
+  typedef typename query_iterator<2>::reference reference;
+  typedef typename query_iterator<2>::pointer pointer;
+  typedef typename query_iterator<2>::value_type value_type;
+  typedef ranges_iterator<Traits> particle_iterator;
+  typedef bbox<dimension> box_type;
+
+  ///
+  /// @brief the number of bits of each bucket index used in a bucket key
+  ///
+  static const unsigned int bucket_key_bits = 64 / dimension;
+
+  ///
+  /// @brief mask of the bits of each bucket index used in a bucket key
+  ///
+  static const uint64_t bucket_key_mask =
+      bucket_key_bits >= 64 ? ~uint64_t(0)
+                            : (uint64_t(1) << (bucket_key_bits % 64)) - 1;
+
+  ///
+  /// @brief pointer to the beginning of the particle set
+  ///
+  raw_pointer m_particles_begin;
+
+  ///
+  /// @brief pointer to the end of the particle set
+  ///
+  raw_pointer m_particles_end;
+
+  ///
+  /// @brief periodicity of the domain (always false)
+  ///
+  bool_d m_periodic;
+
+  ///
+  /// @brief dimensions of each bucket
+  ///
+  double_d m_bucket_side_length;
+
+  ///
+  /// @brief index of the last bucket in the (virtual) grid
+  ///
+  int_d m_end_bucket;
+
+  ///
+  /// @brief min/max bounds of the grid, which covers all the particles
+  ///
+  bbox<dimension> m_bounds;
+
+  ///
+  /// @brief function object to transform a point to a bucket index
+  ///
+  detail::point_to_bucket_index<dimension> m_point_to_bucket_index;
+
+  ///
+  /// @brief pointer to the bucket stored in each slot of the hash table
+  ///
+  int_d *m_table_buckets;
+
+  ///
+  /// @brief pointer to the beginning of the particle range of each slot
+  ///
+  unsigned int *m_table_begin;
+
+  ///
+  /// @brief pointer to the end of the particle range of each slot
+  ///
+  unsigned int *m_table_end;
+
+  ///
+  /// @brief the hash table has 2^m_table_bits slots
+  ///
+  int m_table_bits;
+
+  ///
+  /// @brief a pointer to the "key" values of the find-by-id map
+  ///
+  size_t *m_id_map_key;
+
+  ///
+  /// @brief a pointer to the "value" values of the find-by-id map
+  ///
+  size_t *m_id_map_value;
+
+  ///
+  /// @brief the size of the dense find-by-id map, or zero if it is sorted
+  ///
+  size_t m_id_map_dense_size;
+
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  SpatialHashQuery() {}
+
+  ///
+  /// @brief returns the key of @p bucket, which sorts the buckets in
+  /// lexicographic order. The key is unique if each index of the bucket is
+  /// at most #bucket_key_mask, otherwise distinct buckets can share a key
+  ///
+  CUDA_HOST_DEVICE
+  static uint64_t bucket_key(const int_d &bucket) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < dimension; ++i) {
+      const uint64_t index = static_cast<uint64_t>(bucket[i]) & bucket_key_mask;
+      key = i == 0 ? index : (key << (bucket_key_bits % 64)) | index;
+    }
+    return key;
+  }
+
+  ///
+  /// @brief returns the slot of a hash table with 2^@p bits slots at which to
+  /// start looking for the bucket with key @p key (Fibonacci hashing)
+  ///
+  CUDA_HOST_DEVICE
+  static size_t hash_bucket_key(const uint64_t key, const int bits) {
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+  }
+
+  /*
+   * functions for id mapping
+   */
+
+  ///
+  /// @copydoc NeighbourQueryBase::find()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  raw_pointer find(const size_t id) const {
+    return m_particles_begin +
+           detail::find_in_id_map(m_id_map_key, m_id_map_value,
+                                  m_id_map_dense_size, number_of_particles(),
+                                  id);
+  }
+
+  /*
+   * functions for trees
+   */
+
+  ///
+  /// @copydoc NeighbourQueryBase::is_leaf_node()
+  ///
+  /// always true for SpatialHash
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  static bool is_leaf_node(const value_type &bucket) { return true; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::is_tree()
+  ///
+  /// always false for SpatialHash
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  static bool is_tree() { return false; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_children() const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  child_iterator get_children() const {
+    return child_iterator(int_d::Constant(0), m_end_bucket + 1);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_children(const child_iterator&) const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  child_iterator get_children(const child_iterator &ci) const {
+    return child_iterator();
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::num_children(const child_iterator&) const
+  ///
+  static size_t num_children(const child_iterator &ci) { return 0; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::num_children() const
+  ///
+  size_t num_children() const { return number_of_buckets(); }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bounds()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const box_type get_bounds(const child_iterator &ci) const {
+    box_type bounds;
+    bounds.bmin = (*ci) * m_bucket_side_length + m_bounds.bmin;
+    bounds.bmax = ((*ci) + 1) * m_bucket_side_length + m_bounds.bmin;
+    return bounds;
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bounds()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const box_type &get_bounds() const { return m_bounds; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_periodic()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const bool_d &get_periodic() const { return m_periodic; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket_particles()
+  ///
+  /// Buckets that hold no particles are not in the hash table, and give an
+  /// empty range
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  particle_iterator get_bucket_particles(const reference bucket) const {
+#ifndef __CUDA_ARCH__
+    ASSERT((bucket >= int_d::Constant(0)).all() &&
+               (bucket <= m_end_bucket).all(),
+           "invalid bucket");
+#endif
+
+    const size_t mask = (size_t(1) << m_table_bits) - 1;
+    for (size_t slot = hash_bucket_key(bucket_key(bucket), m_table_bits);
+         m_table_end[slot] != 0; slot = (slot + 1) & mask) {
+      if ((m_table_buckets[slot] == bucket).all()) {
+        const unsigned int range_start_index = m_table_begin[slot];
+        const unsigned int range_end_index = m_table_end[slot];
+#ifndef __CUDA_ARCH__
+        LOG(4, "\tlooking in bucket "
+                   << bucket << ". found "
+                   << range_end_index - range_start_index << " particles");
+#endif
+        return particle_iterator(m_particles_begin + range_start_index,
+                                 m_particles_begin + range_end_index);
+      }
+    }
+    return particle_iterator(m_particles_begin, m_particles_begin);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket_bbox()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  bbox<dimension> get_bucket_bbox(const reference bucket) const {
+    return bbox<dimension>(bucket * m_bucket_side_length + m_bounds.bmin,
+                           (bucket + 1) * m_bucket_side_length + m_bounds.bmin);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  child_iterator get_bucket(const double_d &position) const {
+    auto bucket = m_point_to_bucket_index.find_bucket_index_vector(position);
+    return child_iterator(bucket, bucket + 1);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_bucket_index()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  size_t get_bucket_index(const reference bucket) const {
+    size_t index = 0;
+    for (size_t i = 0; i < dimension; ++i) {
+      index = index * (m_end_bucket[i] + 1) + bucket[i];
+    }
+    return index;
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_buckets_near_point()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  template <int LNormNumber = -1>
+  CUDA_HOST_DEVICE query_iterator<LNormNumber>
+  get_buckets_near_point(const double_d &position,
+                         const double max_distance) const {
+#ifndef __CUDA_ARCH__
+    LOG(4, "\tget_buckets_near_point: position = "
+               << position << " max_distance = " << max_distance);
+#endif
+    return query_iterator<LNormNumber>(position,
+                                       double_d::Constant(max_distance), this);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_buckets_near_point()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  template <int LNormNumber = -1>
+  CUDA_HOST_DEVICE query_iterator<LNormNumber>
+  get_buckets_near_point(const double_d &position,
+                         const double_d &max_distance) const {
+#ifndef __CUDA_ARCH__
+    LOG(4, "\tget_buckets_near_point: position = "
+               << position << " max_distance = " << max_distance);
+#endif
+    return query_iterator<LNormNumber>(position, max_distance, this);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_end_bucket()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const int_d &get_end_bucket() const { return m_end_bucket; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_subtree(const child_iterator&) const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  all_iterator get_subtree(const child_iterator &ci) const {
+    return all_iterator();
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_subtree() const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  all_iterator get_subtree() const {
+    return all_iterator(int_d::Constant(0), m_end_bucket + 1);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::number_of_buckets()
+  ///
+  /// This is the number of buckets in the virtual grid, most of which might be
+  /// empty
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  size_t number_of_buckets() const {
+    size_t n = 1;
+    for (size_t i = 0; i < dimension; ++i) {
+      n *= m_end_bucket[i] + 1;
+    }
+    return n;
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::number_of_particles()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  size_t number_of_particles() const {
+    return (m_particles_end - m_particles_begin);
+  }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_particles_begin() const
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  const raw_pointer &get_particles_begin() const { return m_particles_begin; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::get_particles_begin()
+  ///
+  ABORIA_HOST_DEVICE_IGNORE_WARN
+  CUDA_HOST_DEVICE
+  raw_pointer &get_particles_begin() { return m_particles_begin; }
+
+  ///
+  /// @copydoc NeighbourQueryBase::number_of_levels()
+  ///
+  /// always 2 for SpatialHash
+  ///
+  unsigned number_of_levels() const { return 2; }
+};
+
+template <typename Traits>
+const unsigned int SpatialHashQuery<Traits>::bucket_key_bits;
+
+template <typename Traits>
+const uint64_t SpatialHashQuery<Traits>::bucket_key_mask;
+
+} // namespace Aboria
+
+#endif /* SPATIAL_HASH_H_ */
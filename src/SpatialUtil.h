@@ -134,6 +134,19 @@ std::ostream &operator<<(std::ostream &out, const bbox<D> &b) {
   return out << "bbox(" << b.bmin << "<->" << b.bmax << ")";
 }
 
+///
+/// @brief The space filling curves that can be used to sort particles
+/// spatially
+/// @see Particles::sort_by_space_filling_curve()
+///
+enum class space_filling_curve {
+  /// Z-order curve. Cheap to compute, but consecutive cells can be far apart
+  morton,
+  /// Hilbert curve. Consecutive cells are always adjacent, giving better
+  /// locality than the Morton curve
+  hilbert
+};
+
 }
 
 #endif
@@ -12,6 +12,7 @@
 #include <boost/iterator/transform_iterator.hpp>
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/lambda/lambda.hpp>
+#include <boost/mpl/contains.hpp>
 #include <boost/serialization/nvp.hpp>
 #include <boost/serialization/vector.hpp>
 #include <random>
@@ -197,10 +198,11 @@ struct TraitsCommon {
       ERROR_FIRST_TEMPLATE_ARGUMENT_TO_PARTICLES_MUST_BE_A_STD_TUPLE_TYPE error;
 };
 
+/// Implements TraitsCommon for a given list of variables \p TYPES, which
+/// are stored after the builtin `position`, `id` and `alive` variables
 template <typename traits, unsigned int DomainD, unsigned int SelfD,
           typename... TYPES>
-struct TraitsCommon<std::tuple<TYPES...>, DomainD, SelfD, traits>
-    : public traits {
+struct TraitsCommonImpl : public traits {
 
   template <typename... T>
   using tuple = typename traits::template tuple_type<T...>::type;
@@ -262,12 +264,15 @@ struct TraitsCommon<std::tuple<TYPES...>, DomainD, SelfD, traits>
       random_vector_type;
 
   typedef traits traits_type;
-  typedef mpl::vector<position, id, alive, generator, TYPES...> mpl_type_vector;
+  typedef mpl::vector<position, id, alive, TYPES...> mpl_type_vector;
+
+  /// true if each particle stores its own `generator` variable
+  typedef typename mpl::contains<mpl_type_vector, generator>::type
+      has_generator;
 
   typedef tuple<typename position_vector_type::iterator,
                 typename id_vector_type::iterator,
                 typename alive_vector_type::iterator,
-                typename random_vector_type::iterator,
                 typename traits::template vector_type<
                     typename TYPES::value_type>::type::iterator...>
       tuple_of_iterators_type;
@@ -275,14 +280,12 @@ struct TraitsCommon<std::tuple<TYPES...>, DomainD, SelfD, traits>
   typedef tuple<typename position_vector_type::const_iterator,
                 typename id_vector_type::const_iterator,
                 typename alive_vector_type::const_iterator,
-                typename random_vector_type::const_iterator,
                 typename traits::template vector_type<
                     typename TYPES::value_type>::type::const_iterator...>
       tuple_of_const_iterators_type;
 
   // need a std::tuple here, rather than a thrust one...
   typedef std::tuple<position_vector_type, id_vector_type, alive_vector_type,
-                     random_vector_type,
                      typename traits::template vector_type<
                          typename TYPES::value_type>::type...>
       vectors_data_type;
@@ -581,6 +584,22 @@ struct TraitsCommon<std::tuple<TYPES...>, DomainD, SelfD, traits>
   typedef typename position_vector_type::difference_type difference_type;
 };
 
+/// By default each particle stores a `generator` variable holding its own
+/// random number generator
+template <typename traits, unsigned int DomainD, unsigned int SelfD,
+          typename... TYPES>
+struct TraitsCommon<std::tuple<TYPES...>, DomainD, SelfD, traits>
+    : public TraitsCommonImpl<traits, DomainD, SelfD, generator, TYPES...> {};
+
+/// If the first variable is the stateless_generator tag then the `generator`
+/// variable is omitted, and random numbers are instead drawn from
+/// counter-based streams (see Particles::make_generator())
+template <typename traits, unsigned int DomainD, unsigned int SelfD,
+          typename... TYPES>
+struct TraitsCommon<std::tuple<stateless_generator, TYPES...>, DomainD, SelfD,
+                    traits>
+    : public TraitsCommonImpl<traits, DomainD, SelfD, TYPES...> {};
+
 } // namespace Aboria
 
 #endif // TRAITS_H_
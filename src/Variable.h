@@ -40,10 +40,20 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/preprocessor/cat.hpp>
 #include "Vector.h"
 #include "Random.h"
+#include <type_traits>
 #include <vector>
 
 namespace Aboria {
 
+namespace detail {
+template <typename NAME, typename = void>
+struct is_cold_description : std::false_type {};
+
+template <typename NAME>
+struct is_cold_description<NAME, decltype(void(NAME::is_cold()))>
+    : std::integral_constant<bool, NAME::is_cold()> {};
+}
+
 /// \brief variables are attached to particles and have a name and container type
 ///
 /// \param NAME a type with a \c const char* member variable containing the name of the variable 
@@ -52,6 +62,8 @@ template<typename T, typename NAME>
 struct Variable {
     const char *name = NAME().name;
     typedef T value_type;
+    /// true if reordering of this variable is deferred \see ABORIA_COLD_VARIABLE
+    static const bool cold = detail::is_cold_description<NAME>::value;
 };
 
 /// \brief a macro to conveniently define variable types
@@ -64,6 +76,24 @@ struct Variable {
     };                                                   \
     typedef Variable<DATA_TYPE,BOOST_PP_CAT(NAME,_description)> NAME;   \
 
+/// \brief a macro to define a "cold" variable, one that is rarely accessed
+/// (e.g. a diagnostic). When the particles are reordered by the neighbour
+/// search, cold variables are not permuted with the others. Instead all the
+/// permutations made during one call to Particles::update_positions() (e.g.
+/// deleting particles, sorting by the search structure and by a space
+/// filling curve) are composed and applied to the cold variables in one
+/// gather at the end of the update, so they are always up to date when
+/// accessed
+/// \param NAME the name of the generated type 
+/// \param DATA_TYPE the type used to contain the data of the variable, e.g. \c int, double
+/// \param NAME_STRING a string used to name or describe the variable, e.g. "scalar", "velocity"
+#define ABORIA_COLD_VARIABLE(NAME,DATA_TYPE,NAME_STRING)      \
+    struct BOOST_PP_CAT(NAME,_description) {                            \
+    	const char* name = NAME_STRING; \
+    	static constexpr bool is_cold() { return true; } \
+    };                                                   \
+    typedef Variable<DATA_TYPE,BOOST_PP_CAT(NAME,_description)> NAME;   \
+
 #define ABORIA_VARIABLE_VECTOR(NAME,DATA_TYPE,NAME_STRING)      \
     struct BOOST_PP_CAT(NAME,_description) {                            \
     	const char* name = NAME_STRING; \
@@ -78,5 +108,12 @@ ABORIA_VARIABLE(alive,uint8_t,"is_alive")
 ABORIA_VARIABLE(id,size_t,"id")
 ABORIA_VARIABLE(generator,generator_type,"random_generator_seed")
 
+/// A tag type that can be given as the first type in the variable list of a
+/// Particles container, e.g. `Particles<std::tuple<stateless_generator,
+/// scalar>>`. The container then does not store the per-particle `generator`
+/// variable, and random numbers are drawn from counter-based streams derived
+/// from the seed, the particle id and a step counter
+struct stateless_generator {};
+
 }
 #endif /* VARIABLE_H_ */
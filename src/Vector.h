@@ -408,6 +408,16 @@ public:
     return max;
   }
 
+  /// returns the sum of every element in the vector
+  CUDA_HOST_DEVICE
+  T sum() const {
+    T ret = 0;
+    for (size_t i = 0; i < N; ++i) {
+      ret += mem[i];
+    }
+    return ret;
+  }
+
   /// returns the product of every element in the vector
   CUDA_HOST_DEVICE
   T prod() const {
@@ -0,0 +1,366 @@
+/*
+
+Copyright (c) 2005-2016, University of Oxford.
+All rights reserved.
+
+University of Oxford means the Chancellor, Masters and Scholars of the
+University of Oxford, having an administrative office at Wellington
+Square, Oxford OX1 2JD, UK.
+
+This file is part of Aboria.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+ * Neither the name of the University of Oxford nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef VERLET_LIST_H_
+#define VERLET_LIST_H_
+
+#include "Get.h"
+#include "Log.h"
+#include "NeighbourSearchBase.h"
+#include "Search.h"
+#include "Traits.h"
+#include "Vector.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Aboria {
+
+///
+/// @brief A Verlet (neighbour) list for a particle set, stored in a flat
+/// compressed sparse row (CSR) layout.
+///
+/// The neighbours of particle $i$ are all the particles $j \ne i$ within a
+/// distance $r_c + r_s$ of $i$, where $r_c$ is the cutoff and $r_s$ is the
+/// skin distance. The indices of the neighbours of $i$ are stored in
+/// `get_indices()[get_offsets()[i]]` to `get_indices()[get_offsets()[i+1]]`.
+///
+/// The list is only rebuilt when the particles have moved far enough that a
+/// pair of particles might have moved within the cutoff without being in the
+/// list, i.e. when twice the maximum displacement since the last build is
+/// greater than the skin distance. This class is normally used via
+/// Particles::init_verlet_list() and Particles::get_verlet_list()
+///
+/// @tparam Traits the @ref TraitsCommon type of the particle set
+///
+template <typename Traits> class VerletList {
+  typedef typename Traits::double_d double_d;
+  typedef typename Traits::bool_d bool_d;
+  typedef typename Traits::position position;
+  typedef typename Traits::vector_int vector_int;
+  typedef typename Traits::vector_double_d vector_double_d;
+  static const unsigned int dimension = Traits::dimension;
+
+public:
+  typedef iterator_range<const int *> neighbour_range;
+
+  VerletList()
+      : m_cutoff(0), m_skin(0), m_enabled(false), m_number_of_builds(0) {}
+
+  ///
+  /// @brief sets the cutoff and skin distance, the list is built on the next
+  /// call to update()
+  ///
+  /// @param cutoff the interaction cutoff distance
+  /// @param skin the extra skin distance added to the cutoff
+  ///
+  void set_radius(const double cutoff, const double skin) {
+    CHECK(cutoff > 0, "Verlet list cutoff must be positive");
+    CHECK(skin >= 0, "Verlet list skin must not be negative");
+    m_cutoff = cutoff;
+    m_skin = skin;
+    m_enabled = true;
+    m_positions.clear();
+  }
+
+  ///
+  /// @return true if set_radius() has been called
+  ///
+  bool enabled() const { return m_enabled; }
+
+  ///
+  /// @return the interaction cutoff distance
+  ///
+  double get_cutoff() const { return m_cutoff; }
+
+  ///
+  /// @return the skin distance
+  ///
+  double get_skin() const { return m_skin; }
+
+  ///
+  /// @return the number of times the list has been (re)built
+  ///
+  size_t number_of_builds() const { return m_number_of_builds; }
+
+  ///
+  /// @return the number of particles in the list
+  ///
+  size_t size() const { return m_positions.size(); }
+
+  ///
+  /// @return offsets into get_indices() for each particle (size n+1)
+  ///
+  const vector_int &get_offsets() const { return m_offsets; }
+
+  ///
+  /// @return the concatenated neighbour indices for all particles
+  ///
+  const vector_int &get_indices() const { return m_indices; }
+
+  ///
+  /// @brief returns the indices of all the neighbours of particle @p i
+  ///
+  neighbour_range get_neighbours(const size_t i) const {
+    const int *indices = m_indices.empty() ? nullptr : &*m_indices.begin();
+    return neighbour_range(indices + m_offsets[i], indices + m_offsets[i + 1]);
+  }
+
+  ///
+  /// @brief rebuilds the list if it is out of date
+  ///
+  /// @param query the query object of the particle set
+  /// @return true if the list was rebuilt
+  ///
+  template <typename Query> bool update(const Query &query) {
+    if (!m_enabled) {
+      return false;
+    }
+    if (needs_rebuild(query)) {
+      build(query);
+      return true;
+    }
+    return false;
+  }
+
+  ///
+  /// @brief returns true if twice the maximum particle displacement since the
+  /// last build is more than the skin distance, or if the number of particles
+  /// has changed
+  ///
+  template <typename Query> bool needs_rebuild(const Query &query) const {
+    const size_t n = query.number_of_particles();
+    if (n != m_positions.size()) {
+      return true;
+    }
+    if (n == 0) {
+      return false;
+    }
+    const double_d *r = &get<position>(query.get_particles_begin())[0];
+    const double_d *r0 = &*m_positions.begin();
+    const bool_d &periodic = query.get_periodic();
+    const double_d domain_width =
+        query.get_bounds().bmax - query.get_bounds().bmin;
+    double max_displacement2 = 0;
+    for (size_t i = 0; i < n; ++i) {
+      double_d dx = r[i] - r0[i];
+      for (size_t d = 0; d < dimension; ++d) {
+        if (periodic[d]) {
+          while (dx[d] > 0.5 * domain_width[d]) {
+            dx[d] -= domain_width[d];
+          }
+          while (dx[d] <= -0.5 * domain_width[d]) {
+            dx[d] += domain_width[d];
+          }
+        }
+      }
+      max_displacement2 = std::max(max_displacement2, dx.squaredNorm());
+    }
+    return 4 * max_displacement2 > m_skin * m_skin;
+  }
+
+  ///
+  /// @brief (re)builds the list using the given query object
+  ///
+  /// The list is built in two passes, the first counts the neighbours of each
+  /// particle, and after a scan to obtain the offsets, the second fills in
+  /// the indices
+  ///
+  template <typename Query> void build(const Query &query) {
+    const size_t n = query.number_of_particles();
+    const double radius = m_cutoff + m_skin;
+    LOG(2, "VerletList: building list for " << n << " particles with radius "
+                                            << radius);
+    m_offsets.resize(n + 1);
+    m_positions.resize(n);
+    if (n == 0) {
+      m_offsets[0] = 0;
+      m_indices.clear();
+      ++m_number_of_builds;
+      return;
+    }
+
+    const double_d *r = &get<position>(query.get_particles_begin())[0];
+    int *offsets = iterator_to_raw_pointer(m_offsets.begin());
+    double_d *r0 = iterator_to_raw_pointer(m_positions.begin());
+
+    // count neighbours
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; ++i) {
+      int count = 0;
+      for (auto j = euclidean_search(query, r[i], radius); j != false; ++j) {
+        if (&get<position>(*j) != r + i) {
+          ++count;
+        }
+      }
+      offsets[i + 1] = count;
+      r0[i] = r[i];
+    }
+
+    offsets[0] = 0;
+    for (size_t i = 0; i < n; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    m_indices.resize(offsets[n]);
+    int *indices = iterator_to_raw_pointer(m_indices.begin());
+
+    // fill in neighbour indices
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; ++i) {
+      int index = offsets[i];
+      for (auto j = euclidean_search(query, r[i], radius); j != false; ++j) {
+        const double_d *rj = &get<position>(*j);
+        if (rj != r + i) {
+          indices[index++] = rj - r;
+        }
+      }
+    }
+    ++m_number_of_builds;
+  }
+
+  ///
+  /// @brief permutes the list to match a reordering of the particle set.
+  ///
+  /// This is called by Particles::reorder(). Particles before @p update_start
+  /// are unchanged, and particle @p update_start + k in the new ordering is
+  /// particle `order_begin[k]` in the old ordering. Any particle not in the
+  /// new ordering is assumed to have been deleted, and is removed from all
+  /// the neighbour lists
+  ///
+  /// @param update_start index of the start of the reordered range
+  /// @param order_begin iterator to the start of the new order
+  /// @param order_end iterator to the end of the new order
+  ///
+  template <typename OrderIterator>
+  void reorder(const size_t update_start, OrderIterator order_begin,
+               OrderIterator order_end) {
+    const size_t old_n = m_positions.size();
+    if (!m_enabled || old_n == 0) {
+      return;
+    }
+    const size_t n_order = order_end - order_begin;
+    const size_t new_n = update_start + n_order;
+    LOG(2, "VerletList: reordering list from " << old_n << " to " << new_n
+                                               << " particles");
+
+    // the list is out of date if any new particles have been added
+    for (OrderIterator i = order_begin; i != order_end; ++i) {
+      if (static_cast<size_t>(*i) >= old_n) {
+        m_positions.clear();
+        return;
+      }
+    }
+
+    // new index of each old particle, or -1 if deleted
+    m_new_index.assign(old_n, -1);
+    for (size_t i = 0; i < std::min(update_start, old_n); ++i) {
+      m_new_index[i] = i;
+    }
+    for (size_t k = 0; k < n_order; ++k) {
+      m_new_index[order_begin[k]] = update_start + k;
+    }
+
+    auto old_index = [&](const size_t i) -> size_t {
+      return i < update_start ? i : order_begin[i - update_start];
+    };
+
+    m_other_offsets.resize(new_n + 1);
+    m_other_positions.resize(new_n);
+    m_other_offsets[0] = 0;
+    for (size_t i = 0; i < new_n; ++i) {
+      const size_t oi = old_index(i);
+      int count = 0;
+      for (int j = m_offsets[oi]; j < m_offsets[oi + 1]; ++j) {
+        if (m_new_index[m_indices[j]] >= 0) {
+          ++count;
+        }
+      }
+      m_other_offsets[i + 1] = m_other_offsets[i] + count;
+      m_other_positions[i] = m_positions[oi];
+    }
+    m_other_indices.resize(m_other_offsets[new_n]);
+    for (size_t i = 0; i < new_n; ++i) {
+      const size_t oi = old_index(i);
+      int index = m_other_offsets[i];
+      for (int j = m_offsets[oi]; j < m_offsets[oi + 1]; ++j) {
+        const int new_j = m_new_index[m_indices[j]];
+        if (new_j >= 0) {
+          m_other_indices[index++] = new_j;
+        }
+      }
+    }
+    m_offsets.swap(m_other_offsets);
+    m_indices.swap(m_other_indices);
+    m_positions.swap(m_other_positions);
+  }
+
+private:
+  ///
+  /// @brief offsets into m_indices for each particle
+  ///
+  vector_int m_offsets;
+
+  ///
+  /// @brief concatenated neighbour indices
+  ///
+  vector_int m_indices;
+
+  ///
+  /// @brief particle positions at the last build
+  ///
+  vector_double_d m_positions;
+
+  ///
+  /// @brief temporary storage used by reorder()
+  ///
+  vector_int m_new_index;
+  vector_int m_other_offsets;
+  vector_int m_other_indices;
+  vector_double_d m_other_positions;
+
+  double m_cutoff;
+  double m_skin;
+  bool m_enabled;
+  size_t m_number_of_builds;
+};
+
+} // namespace Aboria
+
+#endif /* VERLET_LIST_H_ */
@@ -6,8 +6,10 @@
 #include "Get.h"
 #include "Traits.h"
 #include <algorithm>
+#include <numeric>
 #include <omp.h>
 #include <random>
+#include <vector>
 
 namespace Aboria {
 
@@ -74,6 +76,118 @@ template <typename T> struct is_std_iterator {
 #endif
 };
 
+//
+// host (std::) implementations. These are run in parallel with OpenMP if
+// HAVE_OPENMP is defined, by splitting the range into one contiguous chunk per
+// thread. They compute the size of a range using `last - first` and index
+// into it directly, so all host iterators must be random access
+//
+
+/// ranges smaller than this are always processed serially
+const size_t host_parallel_min_size = 2048;
+
+/// returns the number of chunks to split a range of size \p n into
+inline int host_num_chunks(const size_t n) {
+#ifdef HAVE_OPENMP
+  if (n < host_parallel_min_size) {
+    return 1;
+  }
+  return std::min(static_cast<size_t>(omp_get_max_threads()), n);
+#else
+  return 1;
+#endif
+}
+
+/// returns the start index of chunk \p c out of \p nchunks
+inline size_t host_chunk_begin(const int c, const int nchunks,
+                               const size_t n) {
+  return c * n / nchunks;
+}
+
+/// sorts each chunk in parallel, then merges pairs of chunks in parallel
+template <typename RandomIt, typename Compare>
+void host_sort(RandomIt first, RandomIt last, Compare comp) {
+  const size_t n = last - first;
+  const int nchunks = host_num_chunks(n);
+  if (nchunks == 1) {
+    std::sort(first, last, comp);
+    return;
+  }
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    std::sort(first + host_chunk_begin(c, nchunks, n),
+              first + host_chunk_begin(c + 1, nchunks, n), comp);
+  }
+  for (int width = 1; width < nchunks; width *= 2) {
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int c = 0; c < nchunks - width; c += 2 * width) {
+      std::inplace_merge(
+          first + host_chunk_begin(c, nchunks, n),
+          first + host_chunk_begin(c + width, nchunks, n),
+          first + host_chunk_begin(std::min(c + 2 * width, nchunks), nchunks, n),
+          comp);
+    }
+  }
+}
+
+/// two pass scan. The first pass reduces each chunk, and the second scans
+/// each chunk starting from the scanned chunk totals. Safe to use in place
+/// (i.e. with \p result == \p first)
+template <typename InputIterator, typename OutputIterator,
+          typename UnaryFunction, typename T, typename AssociativeOperator>
+OutputIterator host_transform_scan(InputIterator first, InputIterator last,
+                                   OutputIterator result,
+                                   UnaryFunction unary_op, T init,
+                                   AssociativeOperator binary_op,
+                                   const bool inclusive) {
+  const size_t n = last - first;
+  if (n == 0) {
+    return result;
+  }
+  const int nchunks = host_num_chunks(n);
+  std::vector<T> chunk_sums(nchunks + 1);
+  chunk_sums[0] = init;
+  if (nchunks > 1) {
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int c = 0; c < nchunks; ++c) {
+      const size_t end = host_chunk_begin(c + 1, nchunks, n);
+      size_t i = host_chunk_begin(c, nchunks, n);
+      T sum = unary_op(first[i]);
+      for (++i; i < end; ++i) {
+        sum = binary_op(sum, unary_op(first[i]));
+      }
+      chunk_sums[c + 1] = sum;
+    }
+    for (int c = 0; c < nchunks; ++c) {
+      chunk_sums[c + 1] = binary_op(chunk_sums[c], chunk_sums[c + 1]);
+    }
+  }
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    const size_t end = host_chunk_begin(c + 1, nchunks, n);
+    T sum = chunk_sums[c];
+    for (size_t i = host_chunk_begin(c, nchunks, n); i < end; ++i) {
+      const T value = unary_op(first[i]);
+      if (inclusive) {
+        sum = binary_op(sum, value);
+        result[i] = sum;
+      } else {
+        result[i] = sum;
+        sum = binary_op(sum, value);
+      }
+    }
+  }
+  return result + n;
+}
+
 template <typename T> struct lower_bound_impl {
   const T &values_first, values_last;
   lower_bound_impl(const T &values_first, const T &values_last)
@@ -100,7 +214,13 @@ template <typename T> struct upper_bound_impl {
 
 template <class ForwardIt, class T>
 void fill(ForwardIt first, ForwardIt last, const T &value, std::true_type) {
-  std::fill(first, last, value);
+  const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(first + i) = value;
+  }
 }
 
 #ifdef HAVE_THRUST
@@ -118,7 +238,14 @@ void fill(ForwardIt first, ForwardIt last, const T &value) {
 template <class InputIt, class UnaryFunction>
 UnaryFunction for_each(InputIt first, InputIt last, UnaryFunction f,
                        std::true_type) {
-  return std::for_each(first, last, f);
+  const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    f(*(first + i));
+  }
+  return f;
 }
 
 #ifdef HAVE_THRUST
@@ -137,7 +264,8 @@ UnaryFunction for_each(InputIt first, InputIt last, UnaryFunction f) {
 
 template <typename RandomIt>
 void sort(RandomIt start, RandomIt end, std::true_type) {
-  std::sort(start, end);
+  host_sort(start, end,
+            std::less<typename std::iterator_traits<RandomIt>::value_type>());
 }
 
 #ifdef HAVE_THRUST
@@ -154,7 +282,7 @@ template <typename RandomIt> void sort(RandomIt start, RandomIt end) {
 template <typename RandomIt, typename StrictWeakOrdering>
 void sort(RandomIt start, RandomIt end, StrictWeakOrdering comp,
           std::true_type) {
-  std::sort(start, end, comp);
+  host_sort(start, end, comp);
 }
 
 #ifdef HAVE_THRUST
@@ -170,9 +298,43 @@ void sort(RandomIt start, RandomIt end, StrictWeakOrdering comp) {
   detail::sort(start, end, comp, typename is_std_iterator<RandomIt>::type());
 }
 
+/// comparison based sort_by_key for host iterators
 template <typename T1, typename T2>
-void sort_by_key(T1 start_keys, T1 end_keys, T2 start_data, std::true_type) {
+void host_comparison_sort_by_key(T1 start_keys, T1 end_keys, T2 start_data) {
   typedef zip_iterator<std::tuple<T1, T2>, mpl::vector<>> pair_zip_type;
+  typedef typename std::iterator_traits<T1>::value_type key_type;
+  typedef typename std::iterator_traits<T2>::value_type data_type;
+
+  const size_t n = end_keys - start_keys;
+  if (n >= host_parallel_min_size) {
+    // sort a permutation (in parallel if possible), then apply it to the keys
+    // and data. Ties are broken by the original index so the result does not
+    // depend on the number of threads
+    std::vector<size_t> permutation(n);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    host_sort(permutation.begin(), permutation.end(),
+              [&start_keys](const size_t a, const size_t b) {
+                return start_keys[a] < start_keys[b] ||
+                       (!(start_keys[b] < start_keys[a]) && a < b);
+              });
+    std::vector<key_type> keys(n);
+    std::vector<data_type> data(n);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; ++i) {
+      keys[i] = *(start_keys + permutation[i]);
+      data[i] = *(start_data + permutation[i]);
+    }
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; ++i) {
+      *(start_keys + i) = keys[i];
+      *(start_data + i) = data[i];
+    }
+    return;
+  }
 
   std::sort(
       pair_zip_type(start_keys, start_data),
@@ -189,19 +351,181 @@ std::sort(
   */
 }
 
+/// returns the number of bits needed to represent all values in [0, max_value]
+inline int bits_to_represent(size_t max_value) {
+  int bits = 0;
+  for (; max_value > 0; max_value >>= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+/// integer keys with fewer elements than this are sorted using
+/// host_comparison_sort_by_key()
+const size_t radix_sort_min_size = 512;
+
+/// Parallel least significant digit radix sort_by_key for host iterators with
+/// integer keys. Each pass sorts by one 8-bit digit. Each thread builds a
+/// histogram of its chunk, and after an (ordered) scan of the histograms,
+/// scatters its chunk to the output, so every pass is stable and the result
+/// does not depend on the number of threads.
+///
+/// If \p key_bits is negative, the range of the keys is found first and only
+/// the bits that vary are sorted. Otherwise all keys must be in the range
+/// [0, 2^key_bits)
+template <typename T1, typename T2>
+void host_radix_sort_by_key(T1 start_keys, T1 end_keys, T2 start_data,
+                            int key_bits) {
+  typedef typename std::iterator_traits<T1>::value_type key_type;
+  typedef typename std::iterator_traits<T2>::value_type data_type;
+  typedef typename std::make_unsigned<key_type>::type unsigned_key_type;
+  const int radix_bits = 8;
+  const size_t nbins = 1 << radix_bits;
+
+  const size_t n = end_keys - start_keys;
+  const int nchunks = host_num_chunks(n);
+
+  key_type min_key = 0;
+  if (key_bits < 0) {
+    std::vector<key_type> chunk_min(nchunks), chunk_max(nchunks);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int c = 0; c < nchunks; ++c) {
+      const size_t end = host_chunk_begin(c + 1, nchunks, n);
+      size_t i = host_chunk_begin(c, nchunks, n);
+      key_type min = start_keys[i];
+      key_type max = min;
+      for (++i; i < end; ++i) {
+        min = std::min(min, static_cast<key_type>(start_keys[i]));
+        max = std::max(max, static_cast<key_type>(start_keys[i]));
+      }
+      chunk_min[c] = min;
+      chunk_max[c] = max;
+    }
+    min_key = *std::min_element(chunk_min.begin(), chunk_min.end());
+    const key_type max_key =
+        *std::max_element(chunk_max.begin(), chunk_max.end());
+    key_bits = bits_to_represent(static_cast<unsigned_key_type>(max_key) -
+                                 static_cast<unsigned_key_type>(min_key));
+  }
+  key_bits = std::min(key_bits, static_cast<int>(8 * sizeof(key_type)));
+  const unsigned_key_type offset = static_cast<unsigned_key_type>(min_key);
+  const int num_passes = (key_bits + radix_bits - 1) / radix_bits;
+  if (num_passes == 0) {
+    return;
+  }
+
+  std::vector<key_type> keys(start_keys, end_keys);
+  std::vector<key_type> other_keys(n);
+  std::vector<data_type> data(start_data, start_data + n);
+  std::vector<data_type> other_data(n);
+  std::vector<size_t> histograms(nchunks * nbins);
+
+  for (int pass = 0; pass < num_passes; ++pass) {
+    const int shift = pass * radix_bits;
+    auto digit = [&](const key_type key) {
+      return ((static_cast<unsigned_key_type>(key) - offset) >> shift) &
+             (nbins - 1);
+    };
+
+    // count the digits in each chunk
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int c = 0; c < nchunks; ++c) {
+      size_t *histogram = histograms.data() + c * nbins;
+      std::fill(histogram, histogram + nbins, 0);
+      const size_t end = host_chunk_begin(c + 1, nchunks, n);
+      for (size_t i = host_chunk_begin(c, nchunks, n); i < end; ++i) {
+        ++histogram[digit(keys[i])];
+      }
+    }
+
+    // scan the histograms, ordered by digit and then by chunk
+    size_t sum = 0;
+    for (size_t d = 0; d < nbins; ++d) {
+      for (int c = 0; c < nchunks; ++c) {
+        const size_t count = histograms[c * nbins + d];
+        histograms[c * nbins + d] = sum;
+        sum += count;
+      }
+    }
+
+    // scatter each chunk to its new position
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int c = 0; c < nchunks; ++c) {
+      size_t *histogram = histograms.data() + c * nbins;
+      const size_t end = host_chunk_begin(c + 1, nchunks, n);
+      for (size_t i = host_chunk_begin(c, nchunks, n); i < end; ++i) {
+        const size_t index = histogram[digit(keys[i])]++;
+        other_keys[index] = keys[i];
+        other_data[index] = data[i];
+      }
+    }
+    keys.swap(other_keys);
+    data.swap(other_data);
+  }
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(start_keys + i) = keys[i];
+    *(start_data + i) = data[i];
+  }
+}
+
+template <typename T1, typename T2>
+void host_sort_by_key(T1 start_keys, T1 end_keys, T2 start_data,
+                      const int key_bits, std::true_type) {
+  if (static_cast<size_t>(end_keys - start_keys) >= radix_sort_min_size) {
+    host_radix_sort_by_key(start_keys, end_keys, start_data, key_bits);
+  } else {
+    host_comparison_sort_by_key(start_keys, end_keys, start_data);
+  }
+}
+
+template <typename T1, typename T2>
+void host_sort_by_key(T1 start_keys, T1 end_keys, T2 start_data,
+                      const int key_bits, std::false_type) {
+  host_comparison_sort_by_key(start_keys, end_keys, start_data);
+}
+
+template <typename T1, typename T2>
+void sort_by_key(T1 start_keys, T1 end_keys, T2 start_data,
+                 const int key_bits, std::true_type) {
+  typedef typename std::iterator_traits<T1>::value_type key_type;
+  host_sort_by_key(start_keys, end_keys, start_data, key_bits,
+                   std::integral_constant<
+                       bool, std::is_integral<key_type>::value &&
+                                 !std::is_same<key_type, bool>::value>());
+}
+
 #ifdef HAVE_THRUST
 template <typename T1, typename T2>
-void sort_by_key(T1 start_keys, T1 end_keys, T2 start_data, std::false_type) {
+void sort_by_key(T1 start_keys, T1 end_keys, T2 start_data,
+                 const int key_bits, std::false_type) {
   thrust::sort_by_key(start_keys, end_keys, start_data);
 }
 #endif
 
+/// sorts the range [\p start_data, \p start_data + (\p end_keys - \p
+/// start_keys)) by the keys in [\p start_keys, \p end_keys). On the host,
+/// integer keys are sorted using a (parallel) radix sort.
+///
+/// \param key_bits an optional hint that all keys are in the range
+/// [0, 2^key_bits), so that only this many bits need to be sorted. If
+/// negative (the default), the range of the keys is calculated
 // TODO: only works for random access iterators
 template <typename T1, typename T2>
-void sort_by_key(T1 start_keys, T1 end_keys, T2 start_data) {
+void sort_by_key(T1 start_keys, T1 end_keys, T2 start_data,
+                 const int key_bits = -1) {
   // TODO: how to check its generically a std iterator as opposed to a
   // thrust::iterator
-  detail::sort_by_key(start_keys, end_keys, start_data,
+  detail::sort_by_key(start_keys, end_keys, start_data, key_bits,
                       typename is_std_iterator<T1>::type());
 }
 
@@ -210,8 +534,14 @@ template <typename ForwardIterator, typename InputIterator,
 void lower_bound(ForwardIterator first, ForwardIterator last,
                  InputIterator values_first, InputIterator values_last,
                  OutputIterator result, std::true_type) {
-  std::transform(values_first, values_last, result,
-                 detail::lower_bound_impl<ForwardIterator>(first, last));
+  const size_t n = values_last - values_first;
+  detail::lower_bound_impl<ForwardIterator> search(first, last);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(result + i) = search(*(values_first + i));
+  }
 }
 
 #ifdef HAVE_THRUST
@@ -263,9 +593,14 @@ template <typename ForwardIterator, typename InputIterator,
 void upper_bound(ForwardIterator first, ForwardIterator last,
                  InputIterator values_first, InputIterator values_last,
                  OutputIterator result, std::true_type) {
-
-  std::transform(values_first, values_last, result,
-                 detail::upper_bound_impl<ForwardIterator>(first, last));
+  const size_t n = values_last - values_first;
+  detail::upper_bound_impl<ForwardIterator> search(first, last);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(result + i) = search(*(values_first + i));
+  }
 }
 
 #ifdef HAVE_THRUST
@@ -291,8 +626,25 @@ void upper_bound(ForwardIterator first, ForwardIterator last,
 template <class InputIt, class T, class BinaryOperation>
 T reduce(InputIt first, InputIt last, T init, BinaryOperation op,
          std::true_type) {
-
-  return std::accumulate(first, last, init, op);
+  const size_t n = last - first;
+  const int nchunks = host_num_chunks(n);
+  if (nchunks == 1) {
+    return std::accumulate(first, last, init, op);
+  }
+  std::vector<T> chunk_sums(nchunks);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    const size_t end = host_chunk_begin(c + 1, nchunks, n);
+    InputIt it = first + host_chunk_begin(c, nchunks, n);
+    T sum = *it;
+    for (++it; it != first + end; ++it) {
+      sum = op(sum, *it);
+    }
+    chunk_sums[c] = sum;
+  }
+  return std::accumulate(chunk_sums.begin(), chunk_sums.end(), init, op);
 }
 
 #ifdef HAVE_THRUST
@@ -307,7 +659,7 @@ T reduce(InputIt first, InputIt last, T init, BinaryOperation op,
 template <class InputIt, class T, class BinaryOperation>
 T reduce(InputIt first, InputIt last, T init, BinaryOperation op) {
 
-  detail::reduce(first, last, init, op,
+  return detail::reduce(first, last, init, op,
                  typename is_std_iterator<InputIt>::type());
 }
 
@@ -315,7 +667,14 @@ template <class InputIterator, class OutputIterator, class UnaryOperation>
 OutputIterator transform(InputIterator first, InputIterator last,
                          OutputIterator result, UnaryOperation op,
                          std::true_type) {
-  return std::transform(first, last, result, op);
+  const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(result + i) = op(*(first + i));
+  }
+  return result + n;
 }
 
 #ifdef HAVE_THRUST
@@ -334,23 +693,21 @@ OutputIterator transform(InputIterator first, InputIterator last,
                            typename is_std_iterator<OutputIterator>::type());
 }
 
-template <class ForwardIterator>
-void sequence(ForwardIterator first, ForwardIterator last, std::true_type) {
-  boost::counting_iterator<unsigned int> count(0);
-  std::transform(
-      first, last, count, first,
-      [](const typename std::iterator_traits<ForwardIterator>::reference,
-         const unsigned int i) { return i; });
-}
-
 template <class ForwardIterator, typename T>
 void sequence(ForwardIterator first, ForwardIterator last, T init,
               std::true_type) {
-  boost::counting_iterator<unsigned int> count(init);
-  std::transform(
-      first, last, count, first,
-      [](const typename std::iterator_traits<ForwardIterator>::reference,
-         const unsigned int i) { return i; });
+  const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(first + i) = init + i;
+  }
+}
+
+template <class ForwardIterator>
+void sequence(ForwardIterator first, ForwardIterator last, std::true_type) {
+  detail::sequence(first, last, 0u, std::true_type());
 }
 
 #ifdef HAVE_THRUST
@@ -381,13 +738,13 @@ void sequence(ForwardIterator first, ForwardIterator last, T init) {
 template <typename ForwardIterator, typename UnaryOperation>
 void tabulate(ForwardIterator first, ForwardIterator last,
               UnaryOperation unary_op, std::true_type) {
-
-  boost::counting_iterator<unsigned int> count(0);
-  std::transform(
-      first, last, count, first,
-      [&unary_op](
-          const typename std::iterator_traits<ForwardIterator>::reference,
-          const unsigned int i) { return unary_op(i); });
+  const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(first + i) = unary_op(static_cast<unsigned int>(i));
+  }
 }
 
 #ifdef HAVE_THRUST
@@ -465,7 +822,14 @@ template <class ForwardIt> ForwardIt unique(ForwardIt first, ForwardIt last) {
 template <typename InputIterator, typename OutputIterator>
 OutputIterator copy(InputIterator first, InputIterator last,
                     OutputIterator result, std::true_type) {
-  return std::copy(first, last, result);
+  const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(result + i) = *(first + i);
+  }
+  return result + n;
 }
 
 #ifdef HAVE_THRUST
@@ -489,13 +853,8 @@ OutputIterator
 transform_exclusive_scan(InputIterator first, InputIterator last,
                          OutputIterator result, UnaryFunction unary_op, T init,
                          AssociativeOperator binary_op, std::true_type) {
-
-  const size_t n = last - first;
-  result[0] = init;
-  for (size_t i = 1; i < n; ++i) {
-    result[i] = binary_op(result[i - 1], unary_op(first[i - 1]));
-  }
-  return result + n;
+  return host_transform_scan(first, last, result, unary_op, init, binary_op,
+                             false);
 }
 
 #ifdef HAVE_THRUST
@@ -526,12 +885,10 @@ OutputIterator transform_exclusive_scan(InputIterator first, InputIterator last,
 template <class InputIt, class OutputIt>
 OutputIt inclusive_scan(InputIt first, InputIt last, OutputIt d_first,
                         std::true_type) {
-#if __cplusplus >= 201703L
-  // C++17 code here
-  return std::inclusive_scan(first, last, d_first);
-#else
-  return std::partial_sum(first, last, d_first);
-#endif
+  typedef typename std::iterator_traits<InputIt>::value_type value_type;
+  return host_transform_scan(first, last, d_first,
+                             [](const value_type &i) { return i; },
+                             value_type(), std::plus<value_type>(), true);
 }
 
 #ifdef HAVE_THRUST
@@ -551,18 +908,10 @@ OutputIt inclusive_scan(InputIt first, InputIt last, OutputIt d_first) {
 template <class InputIt, class OutputIt, class T>
 OutputIt exclusive_scan(InputIt first, InputIt last, OutputIt d_first, T init,
                         std::true_type) {
-#if __cplusplus >= 201703L
-  // C++17 code here
-  return std::exclusive_scan(first, last, d_first,init);
-#else
-  if (first != last) {
-    *d_first++ = init;
-    for (; first != last - 1; ++first, ++d_first) {
-      *d_first = *(d_first - 1) + *first;
-    }
-  }
-  return d_first;
-#endif
+  typedef typename std::iterator_traits<InputIt>::value_type value_type;
+  return host_transform_scan(first, last, d_first,
+                             [](const value_type &i) { return i; }, init,
+                             std::plus<T>(), false);
 }
 
 #ifdef HAVE_THRUST
@@ -585,14 +934,72 @@ OutputIterator
 exclusive_scan_by_key(InputIterator1 first1, InputIterator1 last1,
                       InputIterator2 first2, OutputIterator result, T init,
                       std::true_type) {
-  for (; first1 != last1; ++first2) {
-    *result++ = init;
-    ++first1;
-    for (; *first1 == *(first1 - 1) && first1 != last1;
-         ++first1, ++first2, ++result)
-      *result = *(result - 1) + *first2;
+  const size_t n = last1 - first1;
+  const int nchunks = host_num_chunks(n);
+  if (nchunks == 1) {
+    T sum = init;
+    for (size_t i = 0; i < n; ++i) {
+      if (i > 0 && !(first1[i] == first1[i - 1])) {
+        sum = init;
+      }
+      const T value = first2[i];
+      result[i] = sum;
+      sum = sum + value;
+    }
+    return result + n;
+  }
+
+  // first pass: sum of each chunk from its last segment head, and whether the
+  // chunk contains a segment head at all
+  std::vector<T> chunk_sums(nchunks);
+  std::vector<int> chunk_has_head(nchunks);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    const size_t begin = host_chunk_begin(c, nchunks, n);
+    const size_t end = host_chunk_begin(c + 1, nchunks, n);
+    bool has_head = false;
+    T sum = T();
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0 || !(first1[i] == first1[i - 1])) {
+        has_head = true;
+        sum = init;
+      }
+      sum = (i == begin && !has_head) ? T(first2[i]) : sum + first2[i];
+    }
+    chunk_sums[c] = sum;
+    chunk_has_head[c] = has_head;
+  }
+
+  // scan chunk sums, restarting at chunks that contain a segment head
+  std::vector<T> chunk_carry(nchunks);
+  chunk_carry[0] = init;
+  for (int c = 1; c < nchunks; ++c) {
+    chunk_carry[c] = chunk_has_head[c - 1]
+                         ? chunk_sums[c - 1]
+                         : chunk_carry[c - 1] + chunk_sums[c - 1];
+  }
+
+  // second pass: scan each chunk starting from its carry. Read each value
+  // before writing its result so that this is safe to use in place
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    const size_t begin = host_chunk_begin(c, nchunks, n);
+    const size_t end = host_chunk_begin(c + 1, nchunks, n);
+    T sum = chunk_carry[c];
+    for (size_t i = begin; i < end; ++i) {
+      if (i == 0 || !(first1[i] == first1[i - 1])) {
+        sum = init;
+      }
+      const T value = first2[i];
+      result[i] = sum;
+      sum = sum + value;
+    }
   }
-  return result;
+  return result + n;
 }
 
 #ifdef HAVE_THRUST
@@ -621,8 +1028,11 @@ template <typename InputIterator1, typename InputIterator2,
 void scatter(InputIterator1 first, InputIterator1 last, InputIterator2 map,
              RandomAccessIterator output, std::true_type) {
   const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
   for (size_t i = 0; i < n; ++i) {
-    output[map[i]] = first[i];
+    *(output + map[i]) = *(first + i);
   }
 }
 
@@ -649,11 +1059,13 @@ template <typename InputIterator1, typename InputIterator2,
 void scatter_if(InputIterator1 first, InputIterator1 last, InputIterator2 map,
                 InputIterator3 stencil, RandomAccessIterator output,
                 Predicate pred, std::true_type) {
-
   const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
   for (size_t i = 0; i < n; ++i) {
     if (pred(stencil[i])) {
-      output[map[i]] = first[i];
+      *(output + map[i]) = *(first + i);
     }
   }
 }
@@ -686,11 +1098,13 @@ template <typename InputIterator1, typename InputIterator2,
 void scatter_if(InputIterator1 first, InputIterator1 last, InputIterator2 map,
                 InputIterator3 stencil, RandomAccessIterator output,
                 std::true_type) {
-
   const size_t n = last - first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
   for (size_t i = 0; i < n; ++i) {
     if (stencil[i]) {
-      output[map[i]] = first[i];
+      *(output + map[i]) = *(first + i);
     }
   }
 }
@@ -720,10 +1134,13 @@ template <typename InputIterator, typename RandomAccessIterator,
 void gather(InputIterator map_first, InputIterator map_last,
             RandomAccessIterator input_first, OutputIterator result,
             std::true_type) {
-  std::transform(map_first, map_last, result,
-                 [&input_first](typename InputIterator::value_type const &i) {
-                   return input_first[i];
-                 });
+  const size_t n = map_last - map_first;
+#ifdef HAVE_OPENMP
+#pragma omp parallel for if (n >= host_parallel_min_size)
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    *(result + i) = *(input_first + map_first[i]);
+  }
 }
 
 #ifdef HAVE_THRUST
@@ -749,15 +1166,49 @@ template <typename InputIterator1, typename InputIterator2,
 OutputIterator copy_if(InputIterator1 first, InputIterator1 last,
                        InputIterator2 stencil, OutputIterator result,
                        Predicate pred, std::true_type) {
-  // TODO: need to parallise this....
   const size_t n = last - first;
-  for (size_t i = 0; i < n; ++i) {
-    if (pred(stencil[i])) {
-      *result = first[i];
-      ++result;
+  const int nchunks = host_num_chunks(n);
+  if (nchunks == 1) {
+    for (size_t i = 0; i < n; ++i) {
+      if (pred(stencil[i])) {
+        *result = first[i];
+        ++result;
+      }
+    }
+    return result;
+  }
+  // count the selected elements in each chunk, then copy each chunk to its
+  // offset in result
+  std::vector<size_t> chunk_offsets(nchunks + 1, 0);
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    const size_t end = host_chunk_begin(c + 1, nchunks, n);
+    size_t count = 0;
+    for (size_t i = host_chunk_begin(c, nchunks, n); i < end; ++i) {
+      if (pred(stencil[i])) {
+        ++count;
+      }
+    }
+    chunk_offsets[c + 1] = count;
+  }
+  std::partial_sum(chunk_offsets.begin(), chunk_offsets.end(),
+                   chunk_offsets.begin());
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+  for (int c = 0; c < nchunks; ++c) {
+    const size_t end = host_chunk_begin(c + 1, nchunks, n);
+    OutputIterator out = result + chunk_offsets[c];
+    for (size_t i = host_chunk_begin(c, nchunks, n); i < end; ++i) {
+      if (pred(stencil[i])) {
+        *out = first[i];
+        ++out;
+      }
     }
   }
-  return result;
+  return result + chunk_offsets[nchunks];
 }
 
 #ifdef HAVE_THRUST
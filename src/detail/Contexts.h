@@ -41,6 +41,38 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace Aboria {
 namespace detail {
 
+/// the counter-based random stream last used by a thread, see
+/// get_stream_generator()
+struct stream_generator_cache {
+  const void *particles;
+  uint32_t seed;
+  size_t id;
+  size_t step;
+  generator_type generator;
+};
+
+/// Returns the counter-based random stream of the particle with id \p id in
+/// \p particles, at the current random step of \p particles. The last stream
+/// is cached per thread, so that repeated draws for the same particle within
+/// one evaluation continue along the stream rather than restarting it. Each
+/// particle is evaluated by a single thread, so the result does not depend on
+/// the number of threads
+template <typename ParticlesType>
+generator_type &get_stream_generator(const ParticlesType &particles,
+                                     const size_t id) {
+  static thread_local stream_generator_cache cache = {nullptr, 0, 0, 0,
+                                                      generator_type()};
+  if (cache.particles != &particles || cache.seed != particles.get_seed() ||
+      cache.id != id || cache.step != particles.get_random_step()) {
+    cache.particles = &particles;
+    cache.seed = particles.get_seed();
+    cache.id = id;
+    cache.step = particles.get_random_step();
+    cache.generator = particles.make_generator(id);
+  }
+  return cache.generator;
+}
+
 ////////////////
 /// Contexts ///
 ////////////////
@@ -102,15 +134,31 @@ template <typename labels_type, typename dx_type> struct EvalCtx {
 
     typedef double result_type;
 
+    typedef typename label_type::particles_type::traits_type::has_generator
+        has_generator;
+
     result_type operator()(Expr &expr, EvalCtx const &ctx) const {
       // Normal and uniform terminal types have a operator() that takes a
       // generator. Pass the random generator for the labeled particle to this
       // operator()
       return proto::value(proto::child_c<0>(expr))(
-          // need to const_cast this cause everything is
-          // normally held as a const &. Could cause problems???
-          const_cast<generator_type &>(
-              get<generator>(fusion::at_key<label_type>(ctx.m_labels))));
+          get_generator(expr, ctx, has_generator()));
+    }
+
+    generator_type &get_generator(Expr &expr, EvalCtx const &ctx,
+                                  mpl::true_) const {
+      // need to const_cast this cause everything is
+      // normally held as a const &. Could cause problems???
+      return const_cast<generator_type &>(
+          get<generator>(fusion::at_key<label_type>(ctx.m_labels)));
+    }
+
+    generator_type &get_generator(Expr &expr, EvalCtx const &ctx,
+                                  mpl::false_) const {
+      // no stored generator, use the counter-based stream for this particle
+      return get_stream_generator(
+          proto::value(proto::child_c<1>(expr)).get_particles(),
+          get<id>(fusion::at_key<label_type>(ctx.m_labels)));
     }
   };
 
@@ -275,16 +323,14 @@ template <typename labels_type, typename dx_type> struct EvalCtx {
 
     result_type sum = accum.init;
     // TODO: get query range and put it in box search
-    for (auto b = distance_search<LNormNumber>(
-             particlesb.get_query(), get<position>(ai), accum.max_distance);
-         b != false; ++b) {
-      EvalCtx<map_type, list_type> const new_ctx(
-          // fusion::make_map<label_a_type, label_b_type>(ai, *b),
-          map_type(ai, *b),
-          list_type(b.dx())); // fusion::make_list(b.dx()));
-
-      sum = accum.functor(sum, proto::eval(expr, new_ctx));
-    }
+    for_each_neighbour<LNormNumber>(
+        particlesb.get_query(), get<position>(ai), accum.max_distance,
+        [&](const_b_reference bj, const double_d &dx) {
+          EvalCtx<map_type, list_type> const new_ctx(map_type(ai, bj),
+                                                     list_type(dx));
+
+          sum = accum.functor(sum, proto::eval(expr, new_ctx));
+        });
     return sum;
   }
 
@@ -45,7 +45,12 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Vector.h"
 #include "detail/Chebyshev.h"
 #include "detail/Kernels.h"
+#include "detail/LowRank.h"
+#include <array>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <vector>
 
 #ifdef HAVE_H2LIB
 extern "C" {
@@ -184,9 +189,8 @@ struct BlackBoxExpansions {
       detail::ChebyshevRnSingle<D, N> cheb_rn(p, box);
       lattice_iterator<dimension> mj(int_d::Constant(0), int_d::Constant(N));
       for (size_t j = 0; j < ncheb; ++j, ++mj) {
-        // check ij
-        matrix.template block<BlockCols, BlockCols>(i * BlockCols,
-                                                    j * BlockCols) =
+        matrix.template block<BlockCols, BlockCols>(j * BlockCols,
+                                                    i * BlockCols) =
             cheb_rn(*mj) * blockcol_type::Identity();
       }
     }
@@ -262,8 +266,10 @@ struct BlackBoxExpansions {
         const double_d pj =
             0.5 * (pj_unit_box + 1) * (source_box.bmax - source_box.bmin) +
             source_box.bmin;
-        matrix.template block<BlockRows, BlockCols>(
-            i * BlockRows, j * BlockCols) = m_K(pi, pj);
+        // (via a block matrix so that scalar kernels can be assigned)
+        const Eigen::Matrix<double, BlockRows, BlockCols> block(m_K(pi, pj));
+        matrix.template block<BlockRows, BlockCols>(i * BlockRows,
+                                                    j * BlockCols) = block;
       }
     }
   }
@@ -364,9 +370,208 @@ struct BlackBoxExpansions {
     }
   }
 
+  template <typename RowParticlesType, typename ColParticlesType>
+  void P2P_matrix(p2p_matrix_type &matrix,
+                  const std::vector<size_t> &row_indicies,
+                  const std::vector<size_t> &col_indicies,
+                  const RowParticlesType &row_particles,
+                  const ColParticlesType &col_particles) const {
+    typedef typename RowParticlesType::position row_position;
+    typedef typename ColParticlesType::position col_position;
+    matrix.resize(row_indicies.size() * BlockRows,
+                  col_indicies.size() * BlockCols);
+    for (size_t i = 0; i < row_indicies.size(); ++i) {
+      const double_d &pi = get<row_position>(row_particles)[row_indicies[i]];
+      for (size_t j = 0; j < col_indicies.size(); ++j) {
+        const double_d &pj = get<col_position>(col_particles)[col_indicies[j]];
+        const Eigen::Matrix<double, BlockRows, BlockCols> block(m_K(pi, pj));
+        matrix.template block<BlockRows, BlockCols>(i * BlockRows,
+                                                    j * BlockCols) = block;
+      }
+    }
+  }
+
 #endif
 };
 
+#ifdef HAVE_EIGEN
+/// Storage for the M2L matrices of a H2 matrix. Each weakly connected
+/// (target, source) box pair is given an index into a list of matrices via
+/// insert(), and the matrices are then all calculated using generate().
+///
+/// If the kernel is translation invariant (and deduplicate is true), the
+/// M2L matrix only depends on the sizes of the two boxes and their relative
+/// position. Pairs with the same quantised geometry then share a single
+/// matrix, which for uniform trees (e.g. CellList, HyperOctree) reduces the
+/// number of matrices calculated and stored to a few hundred per level.
+/// Otherwise only pairs with the same absolute position share a matrix.
+///
+/// If set_compression() is given a positive tolerance, each matrix is
+/// instead stored as a low-rank factorisation $UV$ found using the
+/// fully-pivoted adaptive cross approximation, and apply() calculates
+/// $U(Vx)$.
+template <unsigned int D, typename Matrix> class M2LMatrixCache {
+  typedef bbox<D> box_type;
+  typedef Vector<double, D> double_d;
+  typedef std::array<long long, 4 * D> key_type;
+  typedef std::vector<Matrix, Eigen::aligned_allocator<Matrix>>
+      matrices_type;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>
+      dynamic_matrix_type;
+
+  matrices_type m_matrices;
+  std::vector<dynamic_matrix_type> m_U;
+  std::vector<dynamic_matrix_type> m_V;
+  std::vector<std::pair<box_type, box_type>> m_boxes;
+  std::map<key_type, size_t> m_map;
+  bool m_deduplicate;
+  double m_quantum;
+  double m_tolerance;
+  size_t m_generated;
+
+  key_type get_key(const box_type &target_box,
+                   const box_type &source_box) const {
+    const double_d offset = source_box.bmin - target_box.bmin;
+    const double_d target_width = target_box.bmax - target_box.bmin;
+    const double_d source_width = source_box.bmax - source_box.bmin;
+    key_type key;
+    for (size_t i = 0; i < D; ++i) {
+      key[i] = std::llround(offset[i] / m_quantum);
+      key[D + i] = std::llround(target_width[i] / m_quantum);
+      key[2 * D + i] = std::llround(source_width[i] / m_quantum);
+      // the absolute position only matters if not translation invariant
+      key[3 * D + i] =
+          m_deduplicate ? 0 : std::llround(target_box.bmin[i] / m_quantum);
+    }
+    return key;
+  }
+
+public:
+  M2LMatrixCache()
+      : m_deduplicate(false), m_quantum(1.0), m_tolerance(0), m_generated(0) {}
+
+  /// remove all matrices. Box geometry is quantised to a multiple of
+  /// 1e-10 times the largest side of @p domain
+  void clear(const box_type &domain, const bool deduplicate) {
+    m_matrices.clear();
+    m_U.clear();
+    m_V.clear();
+    m_boxes.clear();
+    m_map.clear();
+    m_generated = 0;
+    m_deduplicate = deduplicate;
+    const double_d width = domain.bmax - domain.bmin;
+    double max_width = 0;
+    for (size_t i = 0; i < D; ++i) {
+      if (std::isfinite(width[i])) {
+        max_width = std::max(max_width, width[i]);
+      }
+    }
+    m_quantum = (max_width > 0 ? max_width : 1.0) * 1e-10;
+  }
+
+  /// store matrices generated from now on in low-rank form, with relative
+  /// (Frobenius norm) error @p tolerance. A tolerance <= 0 stores the full
+  /// matrices
+  void set_compression(const double tolerance) { m_tolerance = tolerance; }
+
+  bool compressed() const { return m_tolerance > 0; }
+
+  /// returns the index of the M2L matrix for @p target_box and @p source_box
+  size_t insert(const box_type &target_box, const box_type &source_box) {
+    const key_type key = get_key(target_box, source_box);
+    auto it = m_map.find(key);
+    if (it != m_map.end()) {
+      return it->second;
+    }
+    m_map.emplace(key, m_boxes.size());
+    m_boxes.emplace_back(target_box, source_box);
+    return m_boxes.size() - 1;
+  }
+
+  /// returns the index of a previously inserted M2L matrix with the same
+  /// geometry as @p target_box and @p source_box. Safe to call concurrently.
+  /// A geometry that was never inserted is an error in all builds, as the
+  /// returned index would otherwise be used to read past the end of the cache
+  size_t find(const box_type &target_box, const box_type &source_box) const {
+    auto it = m_map.find(get_key(target_box, source_box));
+    CHECK(it != m_map.end(), "M2L matrix not found in cache");
+    return it->second;
+  }
+
+  /// calculate all the inserted matrices that have not yet been generated
+  template <typename Expansions> void generate(const Expansions &expansions) {
+    typedef typename Expansions::m2l_matrix_type expansions_matrix_type;
+    typedef std::vector<expansions_matrix_type,
+                        Eigen::aligned_allocator<expansions_matrix_type>>
+        expansions_matrices_type;
+    const int start = m_generated;
+    const int n = m_boxes.size();
+    if (compressed()) {
+      m_U.resize(n);
+      m_V.resize(n);
+    } else {
+      m_matrices.resize(n);
+    }
+#ifdef HAVE_OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = start; i < n; ++i) {
+      // (heap allocated as the fixed size matrices can be large)
+      expansions_matrices_type full(1);
+      expansions.M2L_matrix(full[0], m_boxes[i].first, m_boxes[i].second);
+      if (compressed()) {
+        dynamic_matrix_type Z = full[0];
+        const size_t max_k = std::min(Z.rows(), Z.cols());
+        dynamic_matrix_type U(Z.rows(), max_k);
+        dynamic_matrix_type V(max_k, Z.cols());
+        const size_t k =
+            adaptive_cross_approximation_full(Z, max_k, m_tolerance, U, V);
+        m_U[i] = U.leftCols(k);
+        m_V[i] = V.topRows(k);
+      } else {
+        m_matrices[i] = full[0];
+      }
+    }
+    m_generated = n;
+  }
+
+  /// the full matrix at index @p i (not available if compressed)
+  const Matrix &operator[](const size_t i) const {
+    ASSERT(!compressed(), "full M2L matrices are not stored if compressed");
+    return m_matrices[i];
+  }
+
+  /// @p accum += M2L matrix @p i times @p source
+  template <typename DerivedAccum, typename DerivedSource>
+  void apply(const size_t i, Eigen::MatrixBase<DerivedAccum> &accum,
+             const Eigen::MatrixBase<DerivedSource> &source) const {
+    if (compressed()) {
+      accum.noalias() += m_U[i] * (m_V[i] * source);
+    } else {
+      accum.noalias() += m_matrices[i] * source;
+    }
+  }
+
+  /// number of unique matrices stored
+  size_t size() const { return m_boxes.size(); }
+
+  /// average rank of the stored matrices
+  double average_rank() const {
+    if (!compressed()) {
+      return m_matrices.empty()
+                 ? 0
+                 : std::min(m_matrices[0].rows(), m_matrices[0].cols());
+    }
+    size_t sum = 0;
+    for (const auto &U : m_U) {
+      sum += U.cols();
+    }
+    return m_U.empty() ? 0 : sum / static_cast<double>(m_U.size());
+  }
+};
+#endif
+
 #ifdef HAVE_H2LIB
 template <size_t D, typename Function, size_t BlockRows, size_t BlockCols>
 struct H2LibBlackBoxExpansions {
@@ -38,6 +38,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifdef HAVE_EIGEN
 
 #include <Eigen/Core>
+#include <list>
 
 namespace Aboria {
 namespace detail {
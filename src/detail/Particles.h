@@ -50,6 +50,26 @@ template <typename Variables, unsigned int DomainD,
 struct is_particles<Particles<Variables, DomainD, Vector, SearchMethod, Traits>>
     : std::true_type {};
 
+template <typename Reference>
+CUDA_HOST_DEVICE void seed_generator(Reference i, const uint32_t seed,
+                                     mpl::true_) {
+  Aboria::get<generator>(i).seed(seed + uint32_t(Aboria::get<id>(i)));
+}
+
+template <typename Reference>
+CUDA_HOST_DEVICE void seed_generator(Reference i, const uint32_t seed,
+                                     mpl::false_) {}
+
+/// seeds the `generator` variable of particle \p i with \p seed plus its id.
+/// Does nothing for containers using the stateless_generator tag, which have
+/// no `generator` variable
+template <typename Reference>
+CUDA_HOST_DEVICE void seed_generator(Reference i, const uint32_t seed) {
+  seed_generator(i, seed,
+                 typename mpl::contains<typename Reference::mpl_vector_type,
+                                        generator>::type());
+}
+
 template <typename Reference> struct resize_lambda {
   uint32_t seed;
   int next_id;
@@ -66,8 +86,7 @@ template <typename Reference> struct resize_lambda {
     const size_t index = &Aboria::get<id>(i) - start_id_pointer;
     Aboria::get<id>(i) = index + next_id;
 
-    generator_type &gen = Aboria::get<generator>(i);
-    gen.seed(seed + uint32_t(Aboria::get<id>(i)));
+    seed_generator(i, seed);
   }
 };
 
@@ -77,10 +96,7 @@ template <typename Reference> struct set_seed_lambda {
   set_seed_lambda(const uint32_t &seed) : seed(seed) {}
 
   CUDA_HOST_DEVICE
-  void operator()(Reference i) const {
-    generator_type &gen = Aboria::get<generator>(i);
-    gen.seed(seed + uint32_t(Aboria::get<id>(i)));
-  }
+  void operator()(Reference i) const { seed_generator(i, seed); }
 };
 
 template <typename ConstReference> struct is_alive {
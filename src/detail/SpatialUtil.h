@@ -7,6 +7,7 @@
 #include "Vector.h"
 
 #include <bitset>  // std::bitset
+#include <cstdint>
 #include <iomanip> // std::setw
 #include <limits>
 
@@ -144,21 +145,28 @@ template <unsigned int D> struct point_to_bucket_index {
   int get_min_index_by_quadrant(const double r, const int i,
                                 const bool up) const {
     // std::cout << "up = "<<up<<"r = "<<r<<" i = "<<i << std::endl;
-    return std::floor(
-        (r + (up ? 0.5 : -0.5) * m_bucket_side_length[i] - m_bounds.bmin[i]) *
-        m_inv_bucket_side_length[i]);
+    // the down quadrant starts one below the up quadrant, computing both from
+    // the same rounded value so that they never overlap
+    const int up_index = std::floor(
+        (r - m_bounds.bmin[i]) * m_inv_bucket_side_length[i] + 0.5);
+    return up ? up_index : up_index - 1;
   }
 
   CUDA_HOST_DEVICE
   double get_dist_to_bucket(const double r, const int my_index,
                             const int target_index, const int i) const {
+    // a point within rounding error of a bucket edge might be given the
+    // index on either side, so clamp the distance to be non-negative
     if (my_index < target_index) {
       // compare point to lower edge of bucket, return a positive distance
-      return target_index * m_bucket_side_length[i] + m_bounds.bmin[i] - r;
+      const double dist =
+          target_index * m_bucket_side_length[i] + m_bounds.bmin[i] - r;
+      return dist > 0 ? dist : 0.0;
     } else if (my_index > target_index) {
       // compare point to upper edge of bucket, return a positive distance
-      return r -
-             ((target_index + 1) * m_bucket_side_length[i] + m_bounds.bmin[i]);
+      const double dist =
+          r - ((target_index + 1) * m_bucket_side_length[i] + m_bounds.bmin[i]);
+      return dist > 0 ? dist : 0.0;
     } else
       // same index, return 0.0
       return 0.0;
@@ -192,10 +200,25 @@ inline CUDA_HOST_DEVICE int get_leaf_id(int offset) {
 
 inline CUDA_HOST_DEVICE int get_leaf_offset(int id) { return 0x80000000 ^ id; }
 
-inline CUDA_HOST_DEVICE int child_tag_mask(int tag, int which_child, int level,
-                                           int max_level, unsigned int D) {
-  int shift = (max_level - level) * D;
-  return tag | (which_child << shift);
+/// 64-bit Morton code used to tag points and nodes of a HyperOctree. Each
+/// level of the tree uses D bits, with the root level in the most
+/// significant bits
+typedef uint64_t morton_code_type;
+
+/// returns the number of levels that fit into a morton_code_type in D
+/// dimensions
+CUDA_HOST_DEVICE
+constexpr int morton_code_max_level(const unsigned int D) {
+  return 64 / D - 1;
+}
+
+inline CUDA_HOST_DEVICE morton_code_type child_tag_mask(morton_code_type tag,
+                                                        int which_child,
+                                                        int level,
+                                                        int max_level,
+                                                        unsigned int D) {
+  const int shift = (max_level - level) * D;
+  return tag | (static_cast<morton_code_type>(which_child) << shift);
 }
 
 template <int CODE> struct is_a {
@@ -205,40 +228,102 @@ template <int CODE> struct is_a {
   }
 };
 
+///
+/// @brief returns the Morton code of the point @p p, found by splitting @p box
+/// along the middle of each dimension @p max_level times. The splits are
+/// computed exactly as in octree_child_iterator::go_to(), so the point always
+/// lies within the bounds of the leaf it is sorted into
+///
 template <unsigned int D>
-CUDA_HOST_DEVICE int point_to_tag(const Vector<double, D> &p, bbox<D> box,
-                                  int max_level) {
-  typedef Vector<double, D> double_d;
-  typedef Vector<int, D> int_d;
-  int result = 0;
+CUDA_HOST_DEVICE morton_code_type point_to_tag(const Vector<double, D> &p,
+                                               bbox<D> box, int max_level) {
+  morton_code_type result = 0;
 
   for (int level = 1; level <= max_level; ++level) {
-    double_d mid;
-    int_d hi_half;
-
     for (size_t i = 0; i < D; ++i) {
-      // Classify in i-direction
-      mid[i] = 0.5f * (box.bmin[i] + box.bmax[i]);
-      hi_half[i] = (p[i] < mid[i]) ? 0 : 1;
+      // Classify in i-direction and shrink the bounding box, still
+      // encapsulating the point
+      const double mid = 0.5 * (box.bmin[i] + box.bmax[i]);
+      const bool hi_half = !(p[i] < mid);
+      if (hi_half) {
+        box.bmin[i] = mid;
+      } else {
+        box.bmax[i] = mid;
+      }
 
       // Push the bit into the result as we build it
-      result |= hi_half[i];
-      result <<= 1;
+      result = (result << 1) | static_cast<morton_code_type>(hi_half);
     }
+  }
+
+  return result;
+}
 
-    // Shrink the bounding box, still encapsulating the point
+///
+/// @brief returns the index of the point @p p along a Hilbert curve covering
+/// @p box, using @p max_level bits per dimension. Uses Skilling's transpose
+/// algorithm (AIP Conf. Proc. 707, 381 (2004)), so works in any dimension.
+/// Unlike the Morton code, consecutive indices are always neighbouring cells
+///
+template <unsigned int D>
+CUDA_HOST_DEVICE morton_code_type point_to_hilbert_index(
+    const Vector<double, D> &p, const bbox<D> &box, int max_level) {
+  // quantise each coordinate to max_level bits
+  const morton_code_type max_coord =
+      (static_cast<morton_code_type>(1) << max_level) - 1;
+  morton_code_type x[D];
+  for (size_t i = 0; i < D; ++i) {
+    const double width = box.bmax[i] - box.bmin[i];
+    const double scaled =
+        width > 0 ? (p[i] - box.bmin[i]) / width * (max_coord + 1.0) : 0.0;
+    x[i] = scaled <= 0 ? 0
+                       : scaled >= max_coord
+                             ? max_coord
+                             : static_cast<morton_code_type>(scaled);
+  }
+
+  // inverse undo excess work
+  const morton_code_type top = static_cast<morton_code_type>(1)
+                               << (max_level - 1);
+  for (morton_code_type q = top; q > 1; q >>= 1) {
+    const morton_code_type mask = q - 1;
     for (size_t i = 0; i < D; ++i) {
-      box.bmin[i] = (hi_half[i]) ? mid[i] : box.bmin[i];
-      box.bmax[i] = (hi_half[i]) ? box.bmax[i] : mid[i];
+      if (x[i] & q) {
+        x[0] ^= mask;
+      } else {
+        const morton_code_type t = (x[0] ^ x[i]) & mask;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // gray encode
+  for (size_t i = 1; i < D; ++i) {
+    x[i] ^= x[i - 1];
+  }
+  morton_code_type t = 0;
+  for (morton_code_type q = top; q > 1; q >>= 1) {
+    if (x[D - 1] & q) {
+      t ^= q - 1;
     }
   }
-  // Unshift the last
-  result >>= 1;
+  for (size_t i = 0; i < D; ++i) {
+    x[i] ^= t;
+  }
 
+  // interleave the transposed bits, most significant first
+  morton_code_type result = 0;
+  for (int level = max_level - 1; level >= 0; --level) {
+    for (size_t i = 0; i < D; ++i) {
+      result = (result << 1) | ((x[i] >> level) & 1);
+    }
+  }
   return result;
 }
 
-template <unsigned int D> void print_tag(int tag, int max_level) {
+template <unsigned int D>
+void print_tag(morton_code_type tag, int max_level) {
   for (int level = 1; level <= max_level; ++level) {
     std::bitset<D> bits = tag >> (max_level - level) * D;
     std::cout << bits << " ";
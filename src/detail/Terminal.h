@@ -36,6 +36,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef TERMINAL_DETAIL_H_
 #define TERMINAL_DETAIL_H_
 
+#include "Random.h"
 #include "Vector.h"
 
 namespace Aboria {
@@ -126,7 +127,7 @@ struct normal {
   normal(){};
   normal(uint32_t seed) : generator(seed){};
   double operator()() {
-    std::normal_distribution<double> normal_distribution;
+    ziggurat_normal_distribution normal_distribution;
     return normal_distribution(generator);
   }
   /*
@@ -137,7 +138,7 @@ struct normal {
      }
      */
   double operator()(generator_type &gen) const {
-    std::normal_distribution<double> normal_distribution;
+    ziggurat_normal_distribution normal_distribution;
     return normal_distribution(gen);
   }
   generator_type generator;
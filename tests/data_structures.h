@@ -502,6 +502,67 @@ public:
     std::cout << "kd tree" << std::endl;
     helper_data_structure<std::vector, Kdtree>();
   }
+
+  void test_kdtree_threads() {
+#ifdef HAVE_OPENMP
+    std::cout << "kd tree with different numbers of threads" << std::endl;
+    typedef Particles<std::tuple<>, 3, std::vector, Kdtree> particles_type;
+    typedef particles_type::position position;
+    typedef particles_type::query_type query_type;
+
+    // positions on a coarse lattice, so that there are many ties in the sorts
+    // along each dimension
+    const size_t N = 10000;
+    std::vector<vdouble3> positions(N);
+    generator_type gen(3);
+    std::uniform_int_distribution<int> uniform(0, 31);
+    for (vdouble3 &p : positions) {
+      p = vdouble3(uniform(gen), uniform(gen), uniform(gen)) / 32.0;
+    }
+
+    auto build = [&](particles_type &particles, const int threads) {
+      omp_set_num_threads(threads);
+      particles.resize(N);
+      for (size_t i = 0; i < N; ++i) {
+        get<position>(particles)[i] = positions[i];
+      }
+      particles.init_neighbour_search(vdouble3::Constant(0),
+                                      vdouble3::Constant(1),
+                                      vbool3::Constant(false));
+    };
+
+    const int max_threads = omp_get_max_threads();
+    particles_type serial;
+    build(serial, 1);
+    const query_type &serial_query = serial.get_query();
+    for (const int threads : {2, 4, 7}) {
+      particles_type parallel;
+      build(parallel, threads);
+      const query_type &query = parallel.get_query();
+
+      // the same nodes
+      TS_ASSERT_EQUALS(query.number_of_buckets(),
+                       serial_query.number_of_buckets());
+      TS_ASSERT_EQUALS(query.number_of_levels(),
+                       serial_query.number_of_levels());
+      for (size_t i = 0; i < std::min(query.number_of_buckets(),
+                                      serial_query.number_of_buckets());
+           ++i) {
+        TS_ASSERT_EQUALS(query.m_nodes_child[i], serial_query.m_nodes_child[i]);
+        TS_ASSERT_EQUALS(query.m_nodes_split_dim[i],
+                         serial_query.m_nodes_split_dim[i]);
+        TS_ASSERT_EQUALS(query.m_nodes_split_pos[i],
+                         serial_query.m_nodes_split_pos[i]);
+      }
+
+      // the same particle order (ids are given in order of creation)
+      for (size_t i = 0; i < N; ++i) {
+        TS_ASSERT_EQUALS(get<id>(parallel)[i], get<id>(serial)[i]);
+      }
+    }
+    omp_set_num_threads(max_threads);
+#endif
+  }
 };
 
 #endif /* SPATIAL_DATA_STRUCTURES_H_ */
@@ -44,7 +44,9 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 typedef std::chrono::system_clock Clock;
 #include "Level1.h"
 #ifdef HAVE_EIGEN
+#include "H2Matrix.h"
 #include "Kernels.h"
+#include "ParH2Matrix.h"
 #endif
 #include "Chebyshev.h"
 #include "FastMultipoleMethod.h"
@@ -109,6 +111,39 @@ public:
     }
 
 #ifdef HAVE_EIGEN
+    // compressed M2L operators should give the same answer to within the
+    // compression tolerance, whether or not they are shared between box pairs
+    // with the same geometry (the kernels here are translation invariant)
+    std::vector<value_type> target_uncompressed(
+        std::begin(get<TargetFMM>(particles)),
+        std::end(get<TargetFMM>(particles)));
+    for (const bool translation_invariant : {false, true}) {
+      fmm.set_m2l_compression(1e-10, translation_invariant);
+      std::fill(std::begin(get<TargetFMM>(particles)),
+                std::end(get<TargetFMM>(particles)), scalar_traits::Zero());
+      t0 = Clock::now();
+      fmm.matrix_vector_multiply(get<TargetFMM>(particles),
+                                 get<Source>(particles));
+      t1 = Clock::now();
+      time_fmm_eval = t1 - t0;
+      const double L2_compressed = std::inner_product(
+          std::begin(get<TargetFMM>(particles)),
+          std::end(get<TargetFMM>(particles)),
+          std::begin(target_uncompressed), 0.0,
+          [](const double t1, const double t2) { return t1 + t2; },
+          [](const value_type &t1, const value_type &t2) {
+            return scalar_traits::squaredNorm(t1 - t2);
+          });
+      std::cout << "for fmm with compressed M2L (translation invariant = "
+                << translation_invariant << "):" << std::endl;
+      std::cout << "dimension = " << dimension << ". N = " << N
+                << ". L2 relative difference to uncompressed is "
+                << std::sqrt(L2_compressed / scale)
+                << ". time_fmm_eval = " << time_fmm_eval.count()
+                << std::endl;
+      TS_ASSERT_LESS_THAN(L2_compressed / scale, 1e-12);
+    }
+
     typedef typename ParticlesType::reference reference;
     for (reference p : particles) {
       get<TargetFMM>(p) = scalar_traits::Zero();
@@ -471,6 +506,115 @@ public:
     TS_ASSERT_LESS_THAN(std::sqrt(L2 / scale), 1e-4);
   }
 
+#ifdef HAVE_EIGEN
+  template <unsigned int D, template <typename> class SearchMethod>
+  void helper_h2_matrix(const size_t N) {
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    typedef position_d<D> position;
+    typedef Particles<std::tuple<source>, D, std::vector, SearchMethod>
+        ParticlesType;
+    ParticlesType particles(N);
+
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (size_t i = 0; i < N; i++) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = uniform(gen);
+      }
+      get<source>(particles)[i] = uniform(gen);
+    }
+    particles.init_neighbour_search(double_d::Constant(0),
+                                    double_d::Constant(1),
+                                    bool_d::Constant(false), 10);
+
+    auto kernel = [](const double_d &pa, const double_d &pb) {
+      return std::sqrt((pb - pa).squaredNorm() + 0.1);
+    };
+    auto expansions = make_black_box_expansion<D, 4>(kernel);
+    typedef decltype(expansions) Expansions;
+
+    std::vector<double> target_manual(N, 0.0);
+    for (size_t i = 0; i < N; i++) {
+      for (size_t j = 0; j < N; j++) {
+        target_manual[i] += kernel(get<position>(particles)[i],
+                                   get<position>(particles)[j]) *
+                            get<source>(particles)[j];
+      }
+    }
+
+    auto relative_difference = [](const std::vector<double> &a,
+                                  const std::vector<double> &b) {
+      double L2 = 0;
+      double scale = 0;
+      for (size_t i = 0; i < a.size(); ++i) {
+        L2 += std::pow(a[i] - b[i], 2);
+        scale += std::pow(b[i], 2);
+      }
+      return std::sqrt(L2 / scale);
+    };
+
+    auto multiply = [&](const auto &matrix) {
+      std::vector<double> target(N, 0.0);
+      matrix.matrix_vector_multiply(target, get<source>(particles));
+      return target;
+    };
+
+    H2Matrix<Expansions, ParticlesType> h2(particles, particles, expansions);
+    const std::vector<double> target_h2 = multiply(h2);
+    std::cout << "dimension = " << D << ". relative error of h2 matrix = "
+              << relative_difference(target_h2, target_manual) << std::endl;
+    TS_ASSERT_LESS_THAN(relative_difference(target_h2, target_manual), 1e-4);
+
+    // sharing the M2L matrices between box pairs with the same geometry only
+    // changes the rounding error
+    H2Matrix<Expansions, ParticlesType> h2_shared(particles, particles,
+                                                  expansions, true);
+    const std::vector<double> target_shared = multiply(h2_shared);
+    TS_ASSERT_LESS_THAN(relative_difference(target_shared, target_h2), 1e-12);
+
+    // compressed M2L matrices agree to within the compression tolerance
+    H2Matrix<Expansions, ParticlesType> h2_compressed(particles, particles,
+                                                      expansions, true, 1e-8);
+    const std::vector<double> target_compressed = multiply(h2_compressed);
+    std::cout << "dimension = " << D
+              << ". relative difference with compressed M2L = "
+              << relative_difference(target_compressed, target_h2)
+              << std::endl;
+    TS_ASSERT_LESS_THAN(relative_difference(target_compressed, target_h2),
+                        1e-6);
+
+    ParH2Matrix<Expansions, ParticlesType> par_h2(particles, particles,
+                                                  expansions, true);
+    const std::vector<double> target_par = multiply(par_h2);
+    TS_ASSERT_LESS_THAN(relative_difference(target_par, target_h2), 1e-12);
+
+#ifdef HAVE_OPENMP
+    // the result does not depend on the number of threads
+    const int max_threads = omp_get_max_threads();
+    for (int nthreads = 1; nthreads <= 4; nthreads *= 2) {
+      omp_set_num_threads(nthreads);
+      const std::vector<double> target_threads = multiply(h2);
+      const std::vector<double> target_par_threads = multiply(par_h2);
+      for (size_t i = 0; i < N; i++) {
+        TS_ASSERT_EQUALS(target_threads[i], target_h2[i]);
+        TS_ASSERT_EQUALS(target_par_threads[i], target_par[i]);
+      }
+    }
+    omp_set_num_threads(max_threads);
+#endif
+  }
+#endif
+
+  void test_h2_matrix() {
+#ifdef HAVE_EIGEN
+    helper_h2_matrix<1, Kdtree>(1000);
+    helper_h2_matrix<2, Kdtree>(1000);
+    helper_h2_matrix<2, HyperOctree>(1000);
+    helper_h2_matrix<3, Kdtree>(1000);
+#endif
+  }
+
   void test_fmm_operators() {
     const unsigned int D = 2;
     typedef Vector<double, D> double_d;
@@ -304,6 +304,41 @@ O(log(N)) time.
               << " versus brute force = " << dt_brute.count() << std::endl;
   }
 
+  template <template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_sparse_ids(const size_t id_spacing) {
+    typedef Particles<std::tuple<>, 2, VectorType, SearchMethod> particles_type;
+    typedef typename particles_type::position position;
+    const int N = 1000;
+    particles_type particles(N);
+    generator_type gen(1);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      get<position>(particles)[i] = vdouble2(uniform(gen), uniform(gen));
+      get<id>(particles)[i] = id_spacing * i;
+    }
+    particles.init_neighbour_search(vdouble2::Constant(-1),
+                                    vdouble2::Constant(1),
+                                    vbool2::Constant(false));
+    particles.init_id_search();
+
+    // delete a particle so that the map is rebuilt
+    const size_t deleted_id = get<id>(particles)[N / 2];
+    get<alive>(particles)[N / 2] = false;
+    particles.update_positions();
+
+    const auto &query = particles.get_query();
+    for (size_t i = 0; i < particles.size(); ++i) {
+      TS_ASSERT_EQUALS(query.find(get<id>(particles)[i]) -
+                           query.get_particles_begin(),
+                       i);
+    }
+    TS_ASSERT_EQUALS(query.find(deleted_id) - query.get_particles_begin(),
+                     particles.size());
+    TS_ASSERT_EQUALS(query.find(id_spacing * N) - query.get_particles_begin(),
+                     particles.size());
+  }
+
   template <template <typename, typename> class VectorType,
             template <typename> class SearchMethod>
   void helper_d_test_list_random() {
@@ -316,6 +351,10 @@ O(log(N)) time.
     helper_d_random<2, VectorType, SearchMethod>(1000, true, false);
     helper_d_random<2, VectorType, SearchMethod>(1000, false, true);
     helper_d_random<2, VectorType, SearchMethod>(1000, true, true);
+
+    // compact ids use the dense id map, sparse ids the sorted one
+    helper_sparse_ids<VectorType, SearchMethod>(1);
+    helper_sparse_ids<VectorType, SearchMethod>(100);
   }
 
   void test_std_vector_CellList(void) {
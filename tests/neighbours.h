@@ -155,6 +155,25 @@ public:
 
     /*`
 
+    If you need a fixed number of neighbours, rather than all the neighbours
+    within a fixed radius, you can use the [funcref Aboria::knn_search]
+    function. This returns a `std::vector` holding the `k` nearest particles to
+    the query point, sorted by increasing distance. Each element of the vector
+    is a [classref Aboria::knn_neighbour], which holds a pointer to the found
+    particle, the $\mathbf{dx}\_{ij}$ vector (again taking into account any
+    periodicity) and the distance between the two points. For example, the
+    following finds the 5 nearest particles to the point $(0,0,0)$
+
+    */
+
+    for (const auto &i :
+         knn_search(particles.get_query(), vdouble3::Constant(0), 5)) {
+      std::cout << "Found a particle with dx = " << i.dx
+                << " and id = " << get<id>(*i.particle) << "\n";
+    }
+
+    /*`
+
     Once you start to alter the positions of the particles, you will need to
     update the neighbourhood data structure that is used for the search. This is
     done using the [memberref Aboria::Particles::update_positions] function.
@@ -708,6 +727,42 @@ public:
     }
   };
 
+  template <typename ParticlesType> struct for_each_neighbour_check {
+    typedef typename ParticlesType::raw_reference reference;
+    typedef typename ParticlesType::double_d double_d;
+    typedef typename ParticlesType::query_type query_type;
+    typedef typename ParticlesType::position position;
+    typedef typename query_type::particle_iterator::reference
+        neighbour_reference;
+
+    query_type query;
+    double r;
+
+    for_each_neighbour_check(ParticlesType &particles, double r)
+        : query(particles.get_query()), r(r) {}
+
+    ABORIA_HOST_DEVICE_IGNORE_WARN
+    void operator()(reference i) {
+      // should find the same particles, in the same order, as
+      // euclidean_search
+      auto j = euclidean_search(query, get<position>(i), r);
+      int count = 0;
+      for_each_neighbour(query, get<position>(i), r,
+                         [&](neighbour_reference b, const double_d &dx) {
+                           TS_ASSERT(j != false);
+                           if (j != false) {
+                             TS_ASSERT_EQUALS(&get<position>(b),
+                                              &get<position>(*j));
+                             TS_ASSERT_EQUALS((dx - j.dx()).squaredNorm(), 0);
+                             ++j;
+                           }
+                           ++count;
+                         });
+      TS_ASSERT(j == false);
+      TS_ASSERT_EQUALS(count, int(get<neighbours_brute>(i)));
+    }
+  };
+
   template <typename Query> struct aboria_fast_bucketsearch_check_neighbour {
     typedef bucket_pair_iterator<Query> Iterator;
     typedef typename Iterator::reference reference;
@@ -861,6 +916,12 @@ public:
                              aboria_check<particles_type>(particles, r));
     t1 = Clock::now();
     std::chrono::duration<double> dt_aboria = t1 - t0;
+
+    // callback search should agree with the Aboria search
+    Aboria::detail::for_each(
+        particles.begin(), particles.end(),
+        for_each_neighbour_check<particles_type>(particles, r));
+
     for (size_t i = 0; i < particles.size(); ++i) {
       if (int(get<neighbours_brute>(particles)[i]) !=
           int(get<neighbours_aboria>(particles)[i])) {
@@ -881,6 +942,307 @@ public:
               << " versus brute force = " << dt_brute.count() << std::endl;
   }
 
+  // number of updates that refitted and rebuilt a Kdtree (the other search
+  // data structures have neither)
+  template <typename Traits>
+  static std::pair<size_t, size_t> tree_updates(const Kdtree<Traits> &kdtree) {
+    return std::make_pair(kdtree.get_number_of_refits(),
+                          kdtree.get_number_of_rebuilds());
+  }
+
+  template <typename Search>
+  static std::pair<size_t, size_t> tree_updates(const Search &) {
+    return std::make_pair(0, 0);
+  }
+
+  // number of particles that are stored in a different bucket to the one
+  // that contains their position (e.g. in a refitted Kdtree)
+  template <typename Query> static size_t particles_moved_bucket(Query &query) {
+    typedef typename Query::traits_type::position position;
+    size_t n = 0;
+    for (auto i = query.get_subtree(); i != false; ++i) {
+      if (query.is_leaf_node(*i)) {
+        const size_t index = query.get_bucket_index(*i);
+        for (auto p = query.get_bucket_particles(*i); p != false; ++p) {
+          const auto ci = query.get_bucket(get<position>(*p));
+          if (query.get_bucket_index(*ci) != index) {
+            ++n;
+          }
+        }
+      }
+    }
+    return n;
+  }
+
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_moving_particles(const int N, const double r,
+                               const bool is_periodic) {
+    typedef Particles<std::tuple<neighbours_brute, neighbours_aboria>, D,
+                      VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    particles_type particles(N);
+
+    std::cout << "moving particles test (D=" << D
+              << " periodic= " << is_periodic << "  N=" << N << " r=" << r
+              << "):" << std::endl;
+
+    generator_type gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = uniform(gen);
+      }
+    }
+    particles.init_neighbour_search(min, max, periodic, 10);
+
+    // the tiny step moves no particles across a tree split, small steps move
+    // only a few particles into a new bucket, the zero step moves none and the
+    // large step moves most of them. A tree is refitted rather than rebuilt
+    // after the tiny, the first small and the zero step
+    const double steps[] = {1e-5, 0.001, 0.01, 0.0, 0.5, 0.01};
+    for (const double step : steps) {
+      std::vector<size_t> ids_before(get<id>(particles).begin(),
+                                     get<id>(particles).end());
+      for (int i = 0; i < N; ++i) {
+        for (size_t d = 0; d < D; ++d) {
+          double &x = get<position>(particles)[i][d];
+          x += step * uniform(gen);
+          if (!is_periodic) {
+            // keep the particles inside the domain by reflecting them off the
+            // walls (clamping would pile them up at identical positions)
+            if (x < min[d]) {
+              x = 2 * min[d] - x;
+            } else if (x >= max[d]) {
+              x = 2 * max[d] - x - 1e-10;
+            }
+          }
+        }
+      }
+      const auto updates_before =
+          tree_updates(particles.get_neighbour_search());
+      particles.update_positions();
+      const auto updates_after = tree_updates(particles.get_neighbour_search());
+      TS_ASSERT_EQUALS(particles.size(), static_cast<size_t>(N));
+
+      if ((step == steps[0] || step == steps[1] || step == 0.0) &&
+          !is_periodic && updates_before.second > 0) {
+        TS_ASSERT_EQUALS(updates_after.first, updates_before.first + 1);
+        TS_ASSERT_EQUALS(updates_after.second, updates_before.second);
+
+        // the refit is kept even though particles have crossed the splits
+        if (step == steps[1]) {
+          TS_ASSERT_LESS_THAN(0, particles_moved_bucket(particles.get_query()));
+        }
+      }
+
+      if (step == 0.0) {
+        for (int i = 0; i < N; ++i) {
+          TS_ASSERT_EQUALS(get<id>(particles)[i], ids_before[i]);
+        }
+      }
+
+      Aboria::detail::for_each(particles.begin(), particles.end(),
+                               brute_force_check<particles_type>(
+                                   particles, min, max, r * r, is_periodic));
+      Aboria::detail::for_each(particles.begin(), particles.end(),
+                               aboria_check<particles_type>(particles, r));
+      for (int i = 0; i < N; ++i) {
+        TS_ASSERT_EQUALS(int(get<neighbours_brute>(particles)[i]),
+                         int(get<neighbours_aboria>(particles)[i]));
+      }
+    }
+  }
+
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_clustered(const int N, const double r, const int neighbour_n,
+                        const bool is_periodic) {
+    typedef Particles<std::tuple<neighbours_brute, neighbours_aboria>, D,
+                      VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    particles_type particles(N);
+
+    std::cout << "clustered test (D=" << D << " periodic= " << is_periodic
+              << "  N=" << N << " r=" << r << "):" << std::endl;
+
+    // most of the particles are in a small cluster, the rest are spread
+    // uniformly over the domain
+    generator_type gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::normal_distribution<double> cluster(0.5, 0.02);
+    for (int i = 0; i < N; ++i) {
+      const bool in_cluster = i < 0.8 * N;
+      for (size_t d = 0; d < D; ++d) {
+        double x = in_cluster ? cluster(gen) : uniform(gen);
+        get<position>(particles)[i][d] = std::max(min[d], std::min(x, 0.99));
+      }
+    }
+    particles.init_neighbour_search(min, max, periodic, neighbour_n);
+
+    Aboria::detail::for_each(particles.begin(), particles.end(),
+                             brute_force_check<particles_type>(
+                                 particles, min, max, r * r, is_periodic));
+    Aboria::detail::for_each(particles.begin(), particles.end(),
+                             aboria_check<particles_type>(particles, r));
+    Aboria::detail::for_each(
+        particles.begin(), particles.end(),
+        for_each_neighbour_check<particles_type>(particles, r));
+    for (int i = 0; i < N; ++i) {
+      TS_ASSERT_EQUALS(int(get<neighbours_brute>(particles)[i]),
+                       int(get<neighbours_aboria>(particles)[i]));
+    }
+  }
+
+  // a cluster so dense that a CellListAdaptive sub-grid cannot split it, so
+  // that a single sub-bucket holds most of the particles
+  template <unsigned int D> void helper_adaptive_dense_cluster(const int N) {
+    typedef Particles<std::tuple<neighbours_brute, neighbours_aboria>, D,
+                      std::vector, CellListAdaptive>
+        particles_type;
+    typedef typename particles_type::search_type search_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    const double r = 1e-3;
+    const int neighbour_n = 10;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    particles_type particles(N);
+
+    std::cout << "dense cluster test (D=" << D << " N=" << N << "):"
+              << std::endl;
+
+    generator_type gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::normal_distribution<double> cluster(0.5, 1e-4);
+    for (int i = 0; i < N; ++i) {
+      const bool in_cluster = i < 0.8 * N;
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = in_cluster ? cluster(gen) : uniform(gen);
+      }
+    }
+    particles.init_neighbour_search(min, max, bool_d::Constant(false),
+                                    neighbour_n);
+
+    // the buckets are only subdivided once, so the sub-bucket holding the
+    // cluster is still over-full
+    const auto &query = particles.get_query();
+    unsigned int max_count = 0;
+    for (unsigned int b = 0; b < query.m_nbuckets; ++b) {
+      const int s = query.m_sub_size[b];
+      const unsigned int *sub_begin = query.m_sub_begin + query.m_sub_offset[b];
+      for (int j = 0; s > 0 && j < query.sub_grid_size(s); ++j) {
+        max_count = std::max(max_count, sub_begin[j + 1] - sub_begin[j]);
+      }
+    }
+    TS_ASSERT_LESS_THAN(search_type::subdivide_ratio * neighbour_n, max_count);
+
+    // but the neighbour search is still correct
+    Aboria::detail::for_each(particles.begin(), particles.end(),
+                             brute_force_check<particles_type>(
+                                 particles, min, max, r * r, false));
+    Aboria::detail::for_each(particles.begin(), particles.end(),
+                             aboria_check<particles_type>(particles, r));
+    for (int i = 0; i < N; ++i) {
+      TS_ASSERT_EQUALS(int(get<neighbours_brute>(particles)[i]),
+                       int(get<neighbours_aboria>(particles)[i]));
+    }
+  }
+
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_unbounded(const int N, const double r, const int neighbour_n,
+                        const bool flat) {
+    typedef Particles<std::tuple<neighbours_brute, neighbours_aboria>, D,
+                      VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    particles_type particles(N);
+
+    std::cout << "unbounded test (D=" << D << " flat= " << flat
+              << "  N=" << N << " r=" << r << "):" << std::endl;
+
+    generator_type gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] =
+            (flat && d == D - 1) ? 0.0 : uniform(gen);
+      }
+    }
+    particles.init_neighbour_search(neighbour_n);
+
+    // the particles spread out without limit, and finally move far away from
+    // the origin
+    const double scales[] = {1.0, 10.0, 10.0, 1.0};
+    const double shifts[] = {0.0, 0.0, 0.0, 1e6};
+    for (size_t step = 0; step < 4; ++step) {
+      for (int i = 0; i < N; ++i) {
+        double_d &x = get<position>(particles)[i];
+        x = x * scales[step] + shifts[step];
+      }
+      particles.update_positions();
+      TS_ASSERT_EQUALS(particles.size(), static_cast<size_t>(N));
+
+      Aboria::detail::for_each(
+          particles.begin(), particles.end(),
+          brute_force_check<particles_type>(particles, min, max, r * r, false));
+      Aboria::detail::for_each(particles.begin(), particles.end(),
+                               aboria_check<particles_type>(particles, r));
+      for (int i = 0; i < N; ++i) {
+        TS_ASSERT_EQUALS(int(get<neighbours_brute>(particles)[i]),
+                         int(get<neighbours_aboria>(particles)[i]));
+      }
+    }
+
+    // split the particles into two small clusters far apart, so that the
+    // bounding box is almost all empty space
+    for (int i = 0; i < N; ++i) {
+      double_d &x = get<position>(particles)[i];
+      x = (x - shifts[3]) / 100.0;
+      if (i % 2 == 1) {
+        x[0] += 1e6;
+      }
+    }
+    particles.update_positions();
+    Aboria::detail::for_each(
+        particles.begin(), particles.end(),
+        brute_force_check<particles_type>(particles, min, max, r * r, false));
+    Aboria::detail::for_each(particles.begin(), particles.end(),
+                             aboria_check<particles_type>(particles, r));
+    for (int i = 0; i < N; ++i) {
+      TS_ASSERT_EQUALS(int(get<neighbours_brute>(particles)[i]),
+                       int(get<neighbours_aboria>(particles)[i]));
+    }
+
+    // the buckets should still be sized for the particles, not the bounding
+    // box. Check the mean size of the bucket each particle is in
+    const auto &query = particles.get_query();
+    double mean_bucket_size = 0;
+    for (int i = 0; i < N; ++i) {
+      auto bucket = query.get_bucket(get<position>(particles)[i]);
+      mean_bucket_size += query.get_bucket_particles(*bucket).distance_to_end();
+    }
+    mean_bucket_size /= N;
+    TS_ASSERT_LESS_THAN(mean_bucket_size, 4.0 * neighbour_n);
+  }
+
   template <unsigned int D, template <typename, typename> class VectorType,
             template <typename> class SearchMethod>
   void helper_d_random_fast_bucketsearch(const int N, const double r,
@@ -981,6 +1343,424 @@ public:
               << " versus brute force = " << dt_brute.count() << std::endl;
   }
 
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_knn(const int N, const size_t k, const int neighbour_n,
+                  const bool is_periodic) {
+    typedef Particles<std::tuple<scalar>, D, VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    particles_type particles(N);
+
+    std::cout << "knn test (D=" << D << " periodic= " << is_periodic
+              << "  N=" << N << " k=" << k << "):" << std::endl;
+
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = uniform(gen);
+      }
+    }
+    particles.init_neighbour_search(min, max, periodic, neighbour_n);
+
+    for (int q = 0; q < 20; ++q) {
+      double_d centre;
+      for (size_t d = 0; d < D; ++d) {
+        centre[d] = uniform(gen);
+      }
+
+      // brute force distances
+      std::vector<double> brute;
+      for (size_t i = 0; i < particles.size(); ++i) {
+        const double_d dx = particles.correct_dx_for_periodicity(
+            get<position>(particles)[i] - centre);
+        brute.push_back(dx.norm());
+      }
+      std::sort(brute.begin(), brute.end());
+
+      auto neighbours = knn_search(particles.get_query(), centre, k);
+      TS_ASSERT_EQUALS(neighbours.size(), std::min(k, particles.size()));
+      for (size_t i = 0; i < neighbours.size(); ++i) {
+        TS_ASSERT_DELTA(neighbours[i].distance, brute[i], 1e-10);
+        TS_ASSERT_DELTA(neighbours[i].dx.norm(), brute[i], 1e-10);
+        const double_d &p = get<position>(*neighbours[i].particle);
+        TS_ASSERT_DELTA(
+            (particles.correct_dx_for_periodicity(p - centre) -
+             neighbours[i].dx)
+                .norm(),
+            0, 1e-10);
+      }
+    }
+  }
+
+  template <template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_d_test_list_knn() {
+    helper_knn<1, VectorType, SearchMethod>(100, 5, 10, false);
+    helper_knn<1, VectorType, SearchMethod>(100, 5, 10, true);
+    helper_knn<2, VectorType, SearchMethod>(1000, 1, 10, false);
+    helper_knn<2, VectorType, SearchMethod>(1000, 20, 10, true);
+    helper_knn<3, VectorType, SearchMethod>(1000, 10, 10, false);
+    helper_knn<3, VectorType, SearchMethod>(1000, 10, 10, true);
+    helper_knn<3, VectorType, SearchMethod>(10, 20, 10, true);
+  }
+
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_verlet(const int N, const double cutoff, const double skin,
+                     const int neighbour_n, const bool is_periodic) {
+    typedef Particles<std::tuple<scalar>, D, VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    particles_type particles(N);
+
+    std::cout << "verlet list test (D=" << D << " periodic= " << is_periodic
+              << "  N=" << N << " cutoff=" << cutoff << " skin=" << skin
+              << "):" << std::endl;
+
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = uniform(gen);
+      }
+    }
+    particles.init_neighbour_search(min, max, periodic, neighbour_n);
+    particles.init_verlet_list(cutoff, skin);
+
+    // every pair within the cutoff must be in the list
+    auto check_list = [&]() {
+      const auto &list = particles.get_verlet_list();
+      TS_ASSERT_EQUALS(list.size(), particles.size());
+      for (size_t i = 0; i < particles.size(); ++i) {
+        auto neighbours = list.get_neighbours(i);
+        std::vector<int> sorted(neighbours.begin(), neighbours.end());
+        std::sort(sorted.begin(), sorted.end());
+        TS_ASSERT(!std::binary_search(sorted.begin(), sorted.end(), i));
+        for (size_t j = 0; j < particles.size(); ++j) {
+          if (i == j) {
+            continue;
+          }
+          const double_d dx = particles.correct_dx_for_periodicity(
+              get<position>(particles)[j] - get<position>(particles)[i]);
+          if (dx.norm() < cutoff) {
+            TS_ASSERT(std::binary_search(sorted.begin(), sorted.end(), j));
+          }
+        }
+      }
+    };
+
+    auto move_particles = [&](const double distance) {
+      for (size_t i = 0; i < particles.size(); ++i) {
+        double_d dx;
+        for (size_t d = 0; d < D; ++d) {
+          dx[d] = uniform(gen);
+        }
+        double_d &r = get<position>(particles)[i];
+        r += distance * dx / dx.norm();
+        if (!is_periodic) {
+          for (size_t d = 0; d < D; ++d) {
+            r[d] = std::max(-1.0, std::min(0.999, r[d]));
+          }
+        }
+      }
+      particles.update_positions();
+    };
+
+    check_list();
+    TS_ASSERT_EQUALS(particles.get_verlet_list().number_of_builds(), 1);
+
+    // moves smaller than skin/2 do not trigger a rebuild
+    move_particles(0.2 * skin);
+    TS_ASSERT_EQUALS(particles.get_verlet_list().number_of_builds(), 1);
+    check_list();
+
+    // but eventually the list is rebuilt
+    for (int i = 0; i < 5; ++i) {
+      move_particles(0.2 * skin);
+      check_list();
+    }
+    TS_ASSERT_LESS_THAN(1, particles.get_verlet_list().number_of_builds());
+
+    // deleting particles permutes the list rather than rebuilding it
+    const size_t n_builds = particles.get_verlet_list().number_of_builds();
+    for (size_t i = 0; i < particles.size(); i += 3) {
+      get<alive>(particles)[i] = false;
+    }
+    particles.update_positions();
+    TS_ASSERT_EQUALS(particles.get_verlet_list().number_of_builds(), n_builds);
+    check_list();
+  }
+
+  template <template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_d_test_list_verlet() {
+    helper_verlet<1, VectorType, SearchMethod>(100, 0.05, 0.02, 10, false);
+    helper_verlet<2, VectorType, SearchMethod>(500, 0.1, 0.03, 10, true);
+    helper_verlet<3, VectorType, SearchMethod>(500, 0.2, 0.05, 10, false);
+    helper_verlet<3, VectorType, SearchMethod>(500, 0.2, 0.05, 10, true);
+  }
+
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_neighbour_pairs(const int N, const double radius,
+                              const bool is_periodic) {
+    typedef Particles<std::tuple<scalar>, D, VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef typename particles_type::reference reference;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    particles_type particles(N);
+
+    std::cout << "neighbour pairs test (D=" << D << " periodic= " << is_periodic
+              << "  N=" << N << " radius=" << radius << "):" << std::endl;
+
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = uniform(gen);
+      }
+    }
+
+    // bucket side length must be at least radius
+    const int n_particles_in_leaf =
+        std::ceil(N * std::pow(0.5 * radius, D)) + 1;
+    particles.init_neighbour_search(min, max, periodic, n_particles_in_leaf);
+
+    // brute force count of neighbours for each particle
+    std::vector<int> brute_force(N, 0);
+    for (int i = 0; i < N; ++i) {
+      for (int j = 0; j < N; ++j) {
+        const double_d dx = particles.correct_dx_for_periodicity(
+            get<position>(particles)[j] - get<position>(particles)[i]);
+        if (i != j && dx.norm() < radius) {
+          ++brute_force[i];
+        }
+      }
+    }
+
+    // each pair is visited once, so incrementing both particles must give
+    // the full neighbour count
+    auto count_pair = [&](reference a, reference b, const double_d &dx) {
+      const double_d dx_periodic = particles.correct_dx_for_periodicity(
+          get<position>(b) - get<position>(a));
+      TS_ASSERT_DELTA((dx - dx_periodic).norm(), 0, 1e-10);
+      get<scalar>(a) += 1;
+      get<scalar>(b) += 1;
+    };
+    auto check_counts = [&]() {
+      for (int i = 0; i < N; ++i) {
+        TS_ASSERT_EQUALS(get<scalar>(particles)[i], brute_force[i]);
+        get<scalar>(particles)[i] = 0;
+      }
+    };
+
+    std::fill(get<scalar>(particles).begin(), get<scalar>(particles).end(), 0);
+    for_each_neighbour_pair(particles.get_query(), radius, count_pair);
+    check_counts();
+
+    for_each_neighbour_pair_parallel(particles.get_query(), radius, count_pair);
+    check_counts();
+  }
+
+  template <unsigned int D, template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_batch_search(const int N, const double radius,
+                           const bool is_periodic) {
+    typedef Particles<std::tuple<scalar>, D, VectorType, SearchMethod>
+        particles_type;
+    typedef position_d<D> position;
+    typedef typename particles_type::query_type query_type;
+    typedef typename query_type::particle_iterator::reference reference;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    particles_type particles(N);
+
+    std::cout << "batch search test (D=" << D << " periodic= " << is_periodic
+              << "  N=" << N << " radius=" << radius << "):" << std::endl;
+
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(particles)[i][d] = uniform(gen);
+      }
+    }
+    particles.init_neighbour_search(min, max, periodic);
+
+    // the targets are a different set of points
+    std::vector<double_d> targets(N / 2);
+    for (auto &t : targets) {
+      for (size_t d = 0; d < D; ++d) {
+        t[d] = uniform(gen);
+      }
+    }
+
+    const query_type &query = particles.get_query();
+    const double_d *positions = &get<position>(particles)[0];
+    auto check = [&](const batch_search_result<query_type> &result,
+                     const size_t i, const double r) {
+      size_t k = result.offsets[i];
+      for_each_neighbour(query, targets[i], r,
+                         [&](reference b, const double_d &dx) {
+                           TS_ASSERT_LESS_THAN(k, result.offsets[i + 1]);
+                           TS_ASSERT_EQUALS(result.indices[k],
+                                            &get<position>(b) - positions);
+                           if (!result.dx.empty()) {
+                             TS_ASSERT_EQUALS((result.dx[k] - dx).norm(), 0);
+                           }
+                           ++k;
+                         });
+      TS_ASSERT_EQUALS(k, result.offsets[i + 1]);
+    };
+
+    // constant radius
+    auto result = batch_distance_search(query, targets.begin(), targets.end(),
+                                        radius, true);
+    TS_ASSERT_EQUALS(result.offsets.size(), targets.size() + 1);
+    TS_ASSERT_EQUALS(result.dx.size(), result.indices.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+      check(result, i, radius);
+    }
+
+    // variable radius
+    auto target_radius = [&](const size_t i) {
+      return radius * (0.5 + double(i) / targets.size());
+    };
+    result = batch_distance_search(query, targets.begin(), targets.end(),
+                                   target_radius);
+    TS_ASSERT(result.dx.empty());
+    for (size_t i = 0; i < targets.size(); ++i) {
+      check(result, i, target_radius(i));
+    }
+  }
+
+  template <template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_d_test_list_batch_search() {
+    helper_batch_search<1, VectorType, SearchMethod>(100, 0.05, false);
+    helper_batch_search<2, VectorType, SearchMethod>(1000, 0.1, true);
+    helper_batch_search<3, VectorType, SearchMethod>(1000, 0.25, false);
+    helper_batch_search<3, VectorType, SearchMethod>(1000, 0.25, true);
+  }
+
+  template <unsigned int D, template <typename> class RowSearchMethod,
+            template <typename> class ColSearchMethod>
+  void helper_dual_tree(const int N, const double radius,
+                        const bool is_periodic) {
+    typedef Particles<std::tuple<scalar>, D, std::vector, RowSearchMethod>
+        row_particles_type;
+    typedef Particles<std::tuple<scalar>, D, std::vector, ColSearchMethod>
+        col_particles_type;
+    typedef position_d<D> position;
+    typedef Vector<double, D> double_d;
+    typedef Vector<bool, D> bool_d;
+    double_d min = double_d::Constant(-1);
+    double_d max = double_d::Constant(1);
+    bool_d periodic = bool_d::Constant(is_periodic);
+    row_particles_type row_particles(N);
+    col_particles_type col_particles(2 * N);
+
+    std::cout << "dual tree test (D=" << D << " periodic= " << is_periodic
+              << "  N=" << N << " radius=" << radius << "):" << std::endl;
+
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    for (int i = 0; i < N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(row_particles)[i][d] = uniform(gen);
+      }
+    }
+    for (int i = 0; i < 2 * N; ++i) {
+      for (size_t d = 0; d < D; ++d) {
+        get<position>(col_particles)[i][d] = uniform(gen);
+      }
+    }
+    row_particles.init_neighbour_search(min, max, periodic);
+    col_particles.init_neighbour_search(min, max, periodic);
+
+    const auto &row_query = row_particles.get_query();
+    const auto &col_query = col_particles.get_query();
+
+    // count the pairs within radius found by the traversal
+    size_t count = 0;
+    dual_tree_traversal(
+        row_query, col_query, radius,
+        [&](const auto &ci_row, const auto &ci_col, const double_d &offset) {
+          for (auto i = row_query.get_bucket_particles(*ci_row); i != false;
+               ++i) {
+            const double_d pi = get<position>(*i) + offset;
+            for (auto j = col_query.get_bucket_particles(*ci_col); j != false;
+                 ++j) {
+              if ((get<position>(*j) - pi).norm() <= radius) {
+                ++count;
+              }
+            }
+          }
+        });
+
+    size_t count_search = 0;
+    for (int i = 0; i < N; ++i) {
+      for (auto j =
+               euclidean_search(col_query, get<position>(row_particles)[i],
+                                radius);
+           j != false; ++j) {
+        ++count_search;
+      }
+    }
+    TS_ASSERT_EQUALS(count, count_search);
+  }
+
+  template <template <typename> class RowSearchMethod,
+            template <typename> class ColSearchMethod>
+  void helper_d_test_list_dual_tree() {
+    helper_dual_tree<1, RowSearchMethod, ColSearchMethod>(100, 0.05, false);
+    helper_dual_tree<2, RowSearchMethod, ColSearchMethod>(1000, 0.1, true);
+    helper_dual_tree<3, RowSearchMethod, ColSearchMethod>(1000, 0.25, false);
+    helper_dual_tree<3, RowSearchMethod, ColSearchMethod>(1000, 0.25, true);
+  }
+
+  template <template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_d_test_list_neighbour_pairs() {
+    helper_neighbour_pairs<1, VectorType, SearchMethod>(100, 0.05, false);
+    helper_neighbour_pairs<1, VectorType, SearchMethod>(100, 0.05, true);
+    helper_neighbour_pairs<2, VectorType, SearchMethod>(1000, 0.1, false);
+    helper_neighbour_pairs<2, VectorType, SearchMethod>(1000, 0.1, true);
+    helper_neighbour_pairs<3, VectorType, SearchMethod>(1000, 0.25, false);
+    helper_neighbour_pairs<3, VectorType, SearchMethod>(1000, 0.25, true);
+  }
+
+  template <template <typename, typename> class VectorType,
+            template <typename> class SearchMethod>
+  void helper_d_test_list_moving_particles() {
+    helper_moving_particles<1, VectorType, SearchMethod>(1000, 0.05, false);
+    helper_moving_particles<1, VectorType, SearchMethod>(1000, 0.05, true);
+    helper_moving_particles<2, VectorType, SearchMethod>(1000, 0.1, false);
+    helper_moving_particles<2, VectorType, SearchMethod>(1000, 0.1, true);
+    helper_moving_particles<3, VectorType, SearchMethod>(1000, 0.2, false);
+    helper_moving_particles<3, VectorType, SearchMethod>(1000, 0.2, true);
+  }
+
   template <template <typename, typename> class VectorType,
             template <typename> class SearchMethod>
   void helper_d_test_list_regular() {
@@ -1089,6 +1869,10 @@ public:
 
   void test_std_vector_CellList(void) {
     helper_d_test_list_random<std::vector, CellList>();
+    helper_d_test_list_batch_search<std::vector, CellList>();
+    helper_d_test_list_knn<std::vector, CellList>();
+    helper_d_test_list_verlet<std::vector, CellList>();
+    helper_d_test_list_neighbour_pairs<std::vector, CellList>();
     helper_single_particle<std::vector, CellList>();
     helper_two_particles<std::vector, CellList>();
     helper_d_test_list_regular<std::vector, CellList>();
@@ -1096,12 +1880,35 @@ public:
 
   void test_std_vector_CellListOrdered(void) {
     helper_d_test_list_random<std::vector, CellListOrdered>();
+    helper_d_test_list_batch_search<std::vector, CellListOrdered>();
+    helper_d_test_list_dual_tree<CellListOrdered, Kdtree>();
+    helper_d_test_list_dual_tree<CellListOrdered, CellListOrdered>();
+    helper_d_test_list_knn<std::vector, CellListOrdered>();
+    helper_d_test_list_verlet<std::vector, CellListOrdered>();
+    helper_d_test_list_neighbour_pairs<std::vector, CellListOrdered>();
+    helper_d_test_list_moving_particles<std::vector, CellListOrdered>();
     helper_single_particle<std::vector, CellListOrdered>();
     helper_two_particles<std::vector, CellListOrdered>();
 
     helper_d_test_list_regular<std::vector, CellListOrdered>();
   }
 
+  void test_std_vector_CellListAdaptive(void) {
+    helper_d_test_list_random<std::vector, CellListAdaptive>();
+    helper_d_test_list_knn<std::vector, CellListAdaptive>();
+    helper_d_test_list_verlet<std::vector, CellListAdaptive>();
+    helper_d_test_list_neighbour_pairs<std::vector, CellListAdaptive>();
+    helper_d_test_list_random_fast_bucketsearch<std::vector, CellListAdaptive>();
+    helper_single_particle<std::vector, CellListAdaptive>();
+    helper_two_particles<std::vector, CellListAdaptive>();
+    helper_d_test_list_regular<std::vector, CellListAdaptive>();
+    helper_clustered<2, std::vector, CellListAdaptive>(1000, 0.05, 10, false);
+    helper_clustered<3, std::vector, CellListAdaptive>(1000, 0.1, 10, false);
+    helper_clustered<3, std::vector, CellListAdaptive>(1000, 0.1, 10, true);
+    helper_adaptive_dense_cluster<2>(2000);
+    helper_adaptive_dense_cluster<3>(2000);
+  }
+
   void test_std_vector_CellList_fast_bucketsearch(void) {
     helper_d_test_list_random_fast_bucketsearch<std::vector, CellList>();
     helper_single_particle<std::vector, CellList>();
@@ -1118,21 +1925,48 @@ public:
 
   void test_std_vector_Kdtree(void) {
     helper_d_test_list_random<std::vector, Kdtree>();
+    helper_d_test_list_batch_search<std::vector, Kdtree>();
+    helper_d_test_list_dual_tree<Kdtree, Kdtree>();
+    helper_d_test_list_dual_tree<Kdtree, HyperOctree>();
+    helper_d_test_list_dual_tree<Kdtree, CellListOrdered>();
+    helper_d_test_list_knn<std::vector, Kdtree>();
+    helper_d_test_list_verlet<std::vector, Kdtree>();
+    helper_d_test_list_moving_particles<std::vector, Kdtree>();
     helper_d_test_list_regular<std::vector, Kdtree>();
   }
 
   void test_std_vector_KdtreeNanoflann(void) {
 #if not defined(__CUDACC__)
     helper_d_test_list_random<std::vector, KdtreeNanoflann>();
+    helper_d_test_list_knn<std::vector, KdtreeNanoflann>();
     helper_d_test_list_regular<std::vector, KdtreeNanoflann>();
 #endif
   }
 
   void test_std_vector_HyperOctree(void) {
     helper_d_test_list_random<std::vector, HyperOctree>();
+    helper_d_test_list_batch_search<std::vector, HyperOctree>();
+    helper_d_test_list_dual_tree<HyperOctree, HyperOctree>();
+    helper_d_test_list_knn<std::vector, HyperOctree>();
+    helper_d_test_list_verlet<std::vector, HyperOctree>();
     helper_d_test_list_regular<std::vector, HyperOctree>();
   }
 
+  void test_std_vector_SpatialHash(void) {
+    // SpatialHash does not support periodic domains
+    helper_d_random<1, std::vector, SpatialHash>(1000, 0.1, 10, false, false);
+    helper_d_random<2, std::vector, SpatialHash>(1000, 0.2, 1, false, false);
+    helper_d_random<3, std::vector, SpatialHash>(1000, 0.2, 10, false, false);
+    helper_d_random<3, std::vector, SpatialHash>(100, 0.2, 10, false, true);
+    helper_knn<3, std::vector, SpatialHash>(1000, 10, 10, false);
+    helper_verlet<3, std::vector, SpatialHash>(500, 0.2, 0.05, 10, false);
+    helper_neighbour_pairs<2, std::vector, SpatialHash>(1000, 0.1, false);
+    helper_moving_particles<3, std::vector, SpatialHash>(1000, 0.2, false);
+    helper_unbounded<2, std::vector, SpatialHash>(1000, 0.1, 10, false);
+    helper_unbounded<3, std::vector, SpatialHash>(1000, 0.2, 10, false);
+    helper_unbounded<3, std::vector, SpatialHash>(1000, 0.2, 10, true);
+  }
+
   // void test_thrust_vector_CellList(void) {
   //#if //defined(HAVE_THRUST)
   //    helper_d_test_list_regular<thrust::device_vector,CellList>();
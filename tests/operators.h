@@ -902,6 +902,40 @@ the result in `m`.
       TS_ASSERT_EQUALS(ans[i], ans_copy[i]);
     }
 
+    // caching the sparsity pattern, and then the values, gives the same result
+    C.get_first_kernel().set_cache_sparsity(true);
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      ans_copy = C * v;
+      for (size_t i = 0; i < n; i++) {
+        TS_ASSERT_EQUALS(ans[i], ans_copy[i]);
+      }
+    }
+    C.get_first_kernel().set_cache_values(true);
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      ans_copy = C * v;
+      for (size_t i = 0; i < n; i++) {
+        TS_ASSERT_EQUALS(ans[i], ans_copy[i]);
+      }
+    }
+
+    // moving the last particle out of range invalidates the cache
+    //      3  3  0   1   9
+    // C =  3  3  0 * 2 = 9
+    //      0  0  3   3   9
+    get<position>(particles)[2] = vdouble3(diameter * 3, 0, 0);
+    particles.update_positions();
+    ans_copy = C * v;
+    TS_ASSERT_EQUALS(ans_copy[0], 9);
+    TS_ASSERT_EQUALS(ans_copy[1], 9);
+    TS_ASSERT_EQUALS(ans_copy[2], 9);
+    C.get_first_kernel().set_cache_sparsity(false);
+    ans = C * v;
+    for (size_t i = 0; i < n; i++) {
+      TS_ASSERT_EQUALS(ans[i], ans_copy[i]);
+    }
+    get<position>(particles)[2] = vdouble3(diameter * 1.8, 0, 0);
+    particles.update_positions();
+
     //       3  3  0
     //      -1 -1  0
     // C2 =  3  3  3
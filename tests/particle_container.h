@@ -113,6 +113,168 @@ public:
     TS_ASSERT_EQUALS(get<id>(p_value), 101);
   }
 
+  template <template <typename, typename> class V,
+            template <typename> class SearchMethod>
+  void helper_sort_by_space_filling_curve(const space_filling_curve curve) {
+    ABORIA_VARIABLE(scalar, double, "scalar")
+    typedef Particles<std::tuple<scalar>, 2, V, SearchMethod> Test_type;
+    typedef typename Test_type::position position;
+    Test_type test;
+    const int n = 16;
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        typename Test_type::value_type p;
+        // insert in a scattered order
+        get<position>(p) = vdouble2((i * 7) % n + 0.5, (j * 5) % n + 0.5);
+        get<scalar>(p) = get<position>(p)[0] + n * get<position>(p)[1];
+        test.push_back(p);
+      }
+    }
+    test.init_neighbour_search(vdouble2::Constant(0), vdouble2::Constant(n),
+                               vbool2::Constant(false));
+    test.init_id_search();
+    const size_t update_count = test.get_update_count();
+    test.sort_by_space_filling_curve(curve);
+    TS_ASSERT_EQUALS(test.size(), n * n);
+    TS_ASSERT_EQUALS(test.get_update_count(), update_count + 1);
+
+    // variables move with the particles, and the id map follows them
+    double total_jump = 0;
+    for (size_t i = 0; i < test.size(); ++i) {
+      const vdouble2 &p = get<position>(test)[i];
+      TS_ASSERT_EQUALS(get<scalar>(test)[i], p[0] + n * p[1]);
+      auto found = test.get_query().find(get<id>(test)[i]);
+      TS_ASSERT_EQUALS(found - test.get_query().get_particles_begin(), i);
+      if (i > 0) {
+        total_jump += (p - get<position>(test)[i - 1]).norm();
+      }
+      // neighbour search still finds the particle itself
+      int count = 0;
+      for (auto j = euclidean_search(test.get_query(), p, 0.1); j != false;
+           ++j) {
+        ++count;
+      }
+      TS_ASSERT_EQUALS(count, 1);
+    }
+    if (curve == space_filling_curve::hilbert) {
+      // each step along a Hilbert curve on a regular grid is to a neighbour
+      TS_ASSERT_DELTA(total_jump, n * n - 1, 1e-10);
+    } else {
+      TS_ASSERT_LESS_THAN(total_jump, 2 * n * n);
+    }
+
+    // automatic sort every 2 updates
+    test.set_space_filling_curve_sort(curve, 2);
+    for (size_t i = 0; i < test.size(); ++i) {
+      get<position>(test)[i] = vdouble2(n, n) - get<position>(test)[i];
+    }
+    test.update_positions();
+    test.update_positions();
+    for (size_t i = 0; i < test.size(); ++i) {
+      auto found = test.get_query().find(get<id>(test)[i]);
+      TS_ASSERT_EQUALS(found - test.get_query().get_particles_begin(), i);
+    }
+  }
+
+  template <template <typename, typename> class V,
+            template <typename> class SearchMethod>
+  void helper_cold_variables(void) {
+    ABORIA_VARIABLE(hot, double, "hot")
+    ABORIA_COLD_VARIABLE(cold, double, "cold")
+    typedef Particles<std::tuple<hot, cold>, 2, V, SearchMethod> Test_type;
+    typedef typename Test_type::position position;
+    TS_ASSERT(cold::cold);
+    TS_ASSERT(!hot::cold);
+    Test_type test(100);
+    generator_type gen(1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (size_t i = 0; i < test.size(); ++i) {
+      get<position>(test)[i] = vdouble2(uniform(gen), uniform(gen));
+      get<hot>(test)[i] = get<id>(test)[i];
+      get<cold>(test)[i] = get<id>(test)[i];
+    }
+    test.init_neighbour_search(vdouble2::Constant(0), vdouble2::Constant(1),
+                               vbool2::Constant(false));
+
+    // several reorders, including deletions, are composed
+    for (int step = 0; step < 3; ++step) {
+      for (size_t i = 0; i < test.size(); ++i) {
+        get<position>(test)[i] = vdouble2(uniform(gen), uniform(gen));
+      }
+      get<alive>(test)[step] = false;
+      test.update_positions();
+    }
+    TS_ASSERT_EQUALS(test.size(), 97);
+    for (size_t i = 0; i < test.size(); ++i) {
+      TS_ASSERT_EQUALS(get<hot>(test)[i], get<id>(test)[i]);
+      TS_ASSERT_EQUALS(get<cold>(test)[i], get<id>(test)[i]);
+    }
+
+    // the reorder is applied by the end of the update, so access through
+    // individual particles is up to date
+    get<alive>(test)[0] = false;
+    test.update_positions();
+    for (size_t i = 0; i < test.size(); ++i) {
+      TS_ASSERT_EQUALS(get<cold>(test[i]), get<id>(test[i]));
+    }
+
+    // as are the particles within a neighbour search query
+    get<alive>(test)[0] = false;
+    test.update_positions();
+    const auto &query = test.get_query();
+    for (size_t i = 0; i < test.size(); ++i) {
+      TS_ASSERT_EQUALS(*get<cold>(query.get_particles_begin() + i),
+                       *get<id>(query.get_particles_begin() + i));
+    }
+
+    // and when sorting by a space filling curve
+    test.set_space_filling_curve_sort(space_filling_curve::hilbert, 1);
+    get<alive>(test)[0] = false;
+    test.update_positions();
+    test.set_space_filling_curve_sort(space_filling_curve::hilbert, 0);
+    for (size_t i = 0; i < test.size(); ++i) {
+      TS_ASSERT_EQUALS(get<cold>(test[i]), get<id>(test[i]));
+    }
+
+    // appending a container with cold variables
+    get<alive>(test)[0] = false;
+    test.update_positions();
+    Test_type other(test.begin(), test.begin() + 10);
+    for (size_t i = 0; i < other.size(); ++i) {
+      TS_ASSERT_EQUALS(get<cold>(other)[i], get<id>(other)[i]);
+      get<cold>(other)[i] = -2;
+    }
+    const size_t n_before = test.size();
+    test.push_back(other);
+    TS_ASSERT_EQUALS(test.size(), n_before + 10);
+    for (size_t i = 0; i < test.size(); ++i) {
+      if (get<cold>(test)[i] == -2) {
+        get<alive>(test)[i] = false;
+      } else {
+        TS_ASSERT_EQUALS(get<cold>(test)[i], get<id>(test)[i]);
+      }
+    }
+    test.update_positions();
+    TS_ASSERT_EQUALS(test.size(), n_before);
+
+    // adding particles
+    get<alive>(test)[0] = false;
+    test.update_positions();
+    typename Test_type::value_type p;
+    get<position>(p) = vdouble2::Constant(0.5);
+    get<cold>(p) = -1;
+    test.push_back(p);
+    int n_new = 0;
+    for (size_t i = 0; i < test.size(); ++i) {
+      if (get<cold>(test)[i] == -1) {
+        ++n_new;
+      } else {
+        TS_ASSERT_EQUALS(get<cold>(test)[i], get<id>(test)[i]);
+      }
+    }
+    TS_ASSERT_EQUALS(n_new, 1);
+  }
+
   void test_documentation(void) {
 #if not defined(__CUDACC__)
     //[particle_container
@@ -442,6 +604,11 @@ public:
     helper_add_particle2<std::vector, CellList>();
     helper_add_particle2_dimensions<std::vector, CellList>();
     helper_add_delete_particle<std::vector, CellList>();
+    helper_cold_variables<std::vector, CellList>();
+    helper_sort_by_space_filling_curve<std::vector, CellList>(
+        space_filling_curve::hilbert);
+    helper_sort_by_space_filling_curve<std::vector, CellList>(
+        space_filling_curve::morton);
   }
 
   void test_std_vector_CellListOrdered(void) {
@@ -449,6 +616,7 @@ public:
     helper_add_particle2<std::vector, CellListOrdered>();
     helper_add_particle2_dimensions<std::vector, CellListOrdered>();
     helper_add_delete_particle<std::vector, CellListOrdered>();
+    helper_cold_variables<std::vector, CellListOrdered>();
   }
 
   void test_thrust_vector_CellListOrdered(void) {
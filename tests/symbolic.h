@@ -544,12 +544,68 @@ public:
     TS_ASSERT_EQUALS(result2, 2);
   }
 
+  void helper_stateless_random(void) {
+    ABORIA_VARIABLE(scalar, double, "scalar")
+    ABORIA_VARIABLE(vector3, vdouble3, "vector3")
+    typedef Particles<std::tuple<stateless_generator, scalar, vector3>>
+        ParticlesType;
+    ParticlesType particles;
+
+    // position, id, alive, scalar and vector3, with no generator
+    const size_t n_variables = ParticlesType::traits_type::N;
+    TS_ASSERT_EQUALS(n_variables, 5);
+
+    Symbol<scalar> s;
+    Symbol<vector3> v;
+    Label<0, ParticlesType> a(particles);
+    Normal N;
+    VectorSymbolic<double, 3> vector;
+
+    const size_t n = 100;
+    particles.set_seed(0);
+    for (size_t i = 0; i < n; ++i) {
+      ParticlesType::value_type p;
+      get<ParticlesType::position>(p) = vdouble3(i, 0, 0);
+      get<scalar>(p) = 0;
+      get<vector3>(p) = vdouble3::Constant(0);
+      particles.push_back(p);
+    }
+
+    // each particle draws from the stream given by its id and the random step
+    const size_t step = particles.get_random_step();
+    s[a] = N[a];
+    TS_ASSERT_EQUALS(particles.get_random_step(), step + 1);
+    for (size_t i = 0; i < n; ++i) {
+      generator_type gen =
+          particles.make_generator(get<id>(particles[i]), step);
+      ziggurat_normal_distribution normal;
+      TS_ASSERT_EQUALS(get<scalar>(particles[i]), normal(gen));
+    }
+
+    // the next evaluation uses fresh streams
+    std::vector<double> old_s(get<scalar>(particles).begin(),
+                              get<scalar>(particles).end());
+    s[a] = N[a];
+    for (size_t i = 0; i < n; ++i) {
+      TS_ASSERT_DIFFERS(get<scalar>(particles[i]), old_s[i]);
+    }
+
+    // repeated draws for one particle within an evaluation are different
+    v[a] = vector(N[a], N[a], N[a]);
+    for (size_t i = 0; i < n; ++i) {
+      const vdouble3 &vi = get<vector3>(particles[i]);
+      TS_ASSERT_DIFFERS(vi[0], vi[1]);
+      TS_ASSERT_DIFFERS(vi[1], vi[2]);
+    }
+  }
+
   void test_default() {
     helper_create_default_vectors();
     helper_create_double_vector();
     helper_transform();
     helper_neighbours();
     helper_level0_expressions();
+    helper_stateless_random();
   }
 };
 
@@ -109,6 +109,278 @@ public:
     TS_ASSERT_EQUALS(index5_true, index5);
   }
 
+  void test_parallel_algorithms(void) {
+#ifdef HAVE_OPENMP
+    // use several threads (even on a single core) so that the chunked
+    // algorithms are run
+    const int max_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    generator_type gen(7);
+    std::uniform_int_distribution<int> uniform(-1000, 1000);
+    auto positive = [](const int i) { return i > 0; };
+
+    // empty and serial ranges, and ranges that do not divide evenly into
+    // chunks
+    const size_t sizes[] = {0, 1, 1000, 2048, 10007, 100003};
+    for (size_t n : sizes) {
+      std::vector<int> x(n);
+      for (int &xi : x) {
+        xi = uniform(gen);
+      }
+      std::vector<int> expected;
+      std::vector<int> result(n);
+
+      std::copy_if(x.begin(), x.end(), std::back_inserter(expected), positive);
+      auto result_end = detail::copy_if(x.begin(), x.end(), x.begin(),
+                                        result.begin(), positive);
+      TS_ASSERT_EQUALS(static_cast<size_t>(result_end - result.begin()),
+                       expected.size());
+      TS_ASSERT(std::equal(expected.begin(), expected.end(), result.begin()));
+
+      expected.resize(n);
+      std::partial_sum(x.begin(), x.end(), expected.begin());
+      detail::inclusive_scan(x.begin(), x.end(), result.begin());
+      TS_ASSERT(result == expected);
+
+      int sum = 5;
+      for (size_t i = 0; i < n; ++i) {
+        expected[i] = sum;
+        sum += x[i];
+      }
+      detail::exclusive_scan(x.begin(), x.end(), result.begin(), 5);
+      TS_ASSERT(result == expected);
+      // in place
+      result = x;
+      detail::exclusive_scan(result.begin(), result.end(), result.begin(), 5);
+      TS_ASSERT(result == expected);
+
+      TS_ASSERT_EQUALS(detail::reduce(x.begin(), x.end(), 3, std::plus<int>()),
+                       std::accumulate(x.begin(), x.end(), 3));
+
+      expected = x;
+      std::sort(expected.begin(), expected.end());
+      result = x;
+      detail::sort(result.begin(), result.end());
+      TS_ASSERT(result == expected);
+
+      std::sort(expected.begin(), expected.end(), std::greater<int>());
+      result = x;
+      detail::sort(result.begin(), result.end(), std::greater<int>());
+      TS_ASSERT(result == expected);
+    }
+#ifdef HAVE_OPENMP
+    omp_set_num_threads(max_threads);
+#endif
+  }
+
+  // sort (key, index) pairs with detail::host_radix_sort_by_key and check
+  // against std::stable_sort
+  template <typename Key>
+  void helper_radix_sort_by_key(const std::vector<Key> &keys,
+                                const int key_bits) {
+    const size_t n = keys.size();
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](const size_t a, const size_t b) {
+                       return keys[a] < keys[b];
+                     });
+
+    std::vector<Key> sorted_keys(keys);
+    std::vector<size_t> data(n);
+    std::iota(data.begin(), data.end(), 0);
+    detail::host_radix_sort_by_key(sorted_keys.begin(), sorted_keys.end(),
+                                   data.begin(), key_bits);
+    // equal keys keep their original order, so the data is identical
+    TS_ASSERT(data == order);
+    for (size_t i = 0; i < n; ++i) {
+      TS_ASSERT_EQUALS(sorted_keys[i], keys[order[i]]);
+    }
+  }
+
+  void test_radix_sort_by_key(void) {
+#ifdef HAVE_OPENMP
+    // use several threads (even on a single core) so that the histograms are
+    // built in chunks
+    const int max_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    generator_type gen(11);
+    const size_t sizes[] = {detail::radix_sort_min_size, 10007};
+    for (size_t n : sizes) {
+      // signed keys, with many equal keys
+      std::uniform_int_distribution<int> small(-500, 500);
+      std::vector<int> int_keys(n);
+      for (int &k : int_keys) {
+        k = small(gen);
+      }
+      helper_radix_sort_by_key(int_keys, -1);
+
+      // 64-bit signed keys over the full range
+      std::uniform_int_distribution<int64_t> full(
+          std::numeric_limits<int64_t>::min(),
+          std::numeric_limits<int64_t>::max());
+      std::vector<int64_t> int64_keys(n);
+      for (int64_t &k : int64_keys) {
+        k = full(gen);
+      }
+      helper_radix_sort_by_key(int64_keys, -1);
+
+      // 64-bit unsigned keys with a key_bits hint narrower than the key
+      std::uniform_int_distribution<uint64_t> bits20(0, (1 << 20) - 1);
+      std::vector<uint64_t> uint64_keys(n);
+      for (uint64_t &k : uint64_keys) {
+        k = bits20(gen);
+      }
+      helper_radix_sort_by_key(uint64_keys, 20);
+      helper_radix_sort_by_key(uint64_keys, -1);
+
+      // all keys equal
+      helper_radix_sort_by_key(std::vector<int>(n, -3), -1);
+    }
+
+    // sort_by_key uses the radix sort for integer keys
+    std::vector<int> keys = {5, -1, 3, -1, 5, 0};
+    keys.resize(2 * detail::radix_sort_min_size, 2);
+    std::vector<size_t> data(keys.size());
+    std::iota(data.begin(), data.end(), 0);
+    detail::sort_by_key(keys.begin(), keys.end(), data.begin());
+    TS_ASSERT(std::is_sorted(keys.begin(), keys.end()));
+    TS_ASSERT_EQUALS(data[0], 1);
+    TS_ASSERT_EQUALS(data[1], 3);
+    TS_ASSERT_EQUALS(data[2], 5);
+#ifdef HAVE_OPENMP
+    omp_set_num_threads(max_threads);
+#endif
+  }
+
+  void test_exclusive_scan_by_key(void) {
+#ifdef HAVE_OPENMP
+    // use several threads (even on a single core) so that the scan is done in
+    // chunks
+    const int max_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+#endif
+    generator_type gen(9);
+    std::uniform_int_distribution<int> uniform(-1000, 1000);
+
+    // serial reference
+    auto scan_by_key = [](const std::vector<int> &keys,
+                          const std::vector<int> &values, const int init) {
+      std::vector<int> result(keys.size());
+      int sum = init;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        if (i > 0 && keys[i] != keys[i - 1]) {
+          sum = init;
+        }
+        result[i] = sum;
+        sum += values[i];
+      }
+      return result;
+    };
+
+    // segments of random length, most of which span a chunk boundary, a
+    // single segment, segments of length one, and segments that end exactly
+    // on the chunk boundaries (10000 splits evenly into 4 chunks)
+    const size_t sizes[] = {0, 1, 10000, 10007, 100003};
+    const int max_lengths[] = {5000, std::numeric_limits<int>::max(), 1, 2500};
+    for (size_t n : sizes) {
+      for (int max_length : max_lengths) {
+        std::uniform_int_distribution<int> length(1, max_length);
+        std::vector<int> keys(n);
+        std::vector<int> values(n);
+        int key = -1;
+        int remaining = 0;
+        for (size_t i = 0; i < n; ++i) {
+          if (remaining == 0) {
+            ++key;
+            remaining = max_length == 2500 ? 2500 : length(gen);
+          }
+          --remaining;
+          keys[i] = key;
+          values[i] = uniform(gen);
+        }
+        const std::vector<int> expected = scan_by_key(keys, values, 3);
+
+        std::vector<int> result(n);
+        detail::exclusive_scan_by_key(keys.begin(), keys.end(), values.begin(),
+                                      result.begin(), 3);
+        TS_ASSERT(result == expected);
+
+        // in place
+        result = values;
+        detail::exclusive_scan_by_key(keys.begin(), keys.end(), result.begin(),
+                                      result.begin(), 3);
+        TS_ASSERT(result == expected);
+      }
+    }
+#ifdef HAVE_OPENMP
+    omp_set_num_threads(max_threads);
+#endif
+  }
+
+  void test_prng_generate(void) {
+    // bulk generation matches repeated scalar calls, including the engine
+    // state afterwards, for sizes that start and end mid-block
+    generator_type bulk(42), scalar(42);
+    std::vector<uint32_t> out(5000);
+    const size_t sizes[] = {0, 3, 5, 8, 17, 64, 1000, 3903};
+    for (size_t n : sizes) {
+      bulk.generate(out.data(), n);
+      for (size_t i = 0; i < n; ++i) {
+        TS_ASSERT_EQUALS(out[i], scalar());
+      }
+      TS_ASSERT(bulk == scalar);
+    }
+
+    // uniform doubles in [0,1) and normals with roughly unit variance
+    const size_t n = 10001;
+    std::vector<double> u(n), z(n);
+    generate_uniform(bulk, u.data(), n);
+    generate_normal(bulk, z.data(), n);
+    double sum_u = 0, sum_z2 = 0;
+    for (size_t i = 0; i < n; ++i) {
+      TS_ASSERT_LESS_THAN_EQUALS(0.0, u[i]);
+      TS_ASSERT_LESS_THAN(u[i], 1.0);
+      sum_u += u[i];
+      sum_z2 += z[i] * z[i];
+    }
+    TS_ASSERT_DELTA(sum_u / n, 0.5, 0.02);
+    TS_ASSERT_DELTA(sum_z2 / n, 1.0, 0.05);
+  }
+
+  void test_ziggurat_normal(void) {
+    generator_type gen(7);
+    ziggurat_normal_distribution normal;
+    const size_t n = 1000000;
+    double sum = 0, sum2 = 0, sum4 = 0;
+    size_t within_one = 0, in_tail = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const double z = normal(gen);
+      sum += z;
+      sum2 += z * z;
+      sum4 += z * z * z * z;
+      if (std::abs(z) < 1.0) {
+        ++within_one;
+      }
+      if (std::abs(z) > 3.6541528853610088) {
+        ++in_tail;
+      }
+    }
+    TS_ASSERT_DELTA(sum / n, 0.0, 0.005);
+    TS_ASSERT_DELTA(sum2 / n, 1.0, 0.005);
+    TS_ASSERT_DELTA(sum4 / n, 3.0, 0.05);
+    TS_ASSERT_DELTA(double(within_one) / n, 0.6826895, 0.002);
+    TS_ASSERT_DELTA(double(in_tail) / n, 2.58e-4, 0.5e-4);
+
+    // the samples depend only on the stream of the engine
+    generator_type gen1(3), gen2(3);
+    for (size_t i = 0; i < 100; ++i) {
+      TS_ASSERT_EQUALS(normal(gen1), normal(gen2));
+    }
+  }
+
   void test_low_rank(void) {
 #ifdef HAVE_EIGEN
     const unsigned int D = 2;